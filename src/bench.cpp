@@ -0,0 +1,201 @@
+/**
+ * bench.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "bench.hpp"
+
+#include <cassert>
+#include <cmath>
+
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+
+namespace timer
+{
+std::ostream&
+operator<<( std::ostream& os, const BenchResult& result )
+{
+  result.print( "", Stopwatch::MICROSEC, os );
+  return os;
+}
+}
+
+bool
+timer::pin_to_cpu( int cpu )
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  CPU_SET( cpu, &set );
+  return sched_setaffinity( 0, sizeof( set ), &set ) == 0;
+#else
+  ( void ) cpu;
+  return false;
+#endif
+}
+
+timer::CpuPin::CpuPin( int cpu )
+  : _saved( 0 )
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+  if ( cpu < 0 )
+  {
+    return;
+  }
+  cpu_set_t* saved = new cpu_set_t;
+  if ( sched_getaffinity( 0, sizeof( *saved ), saved ) == 0 && pin_to_cpu( cpu ) )
+  {
+    _saved = saved;
+  }
+  else
+  {
+    delete saved;
+  }
+#else
+  ( void ) cpu;
+#endif
+}
+
+timer::CpuPin::~CpuPin()
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+  if ( _saved != 0 )
+  {
+    cpu_set_t* saved = static_cast< cpu_set_t* >( _saved );
+    sched_setaffinity( 0, sizeof( *saved ), saved );
+    delete saved;
+  }
+#endif
+}
+
+bool
+timer::CpuPin::pinned() const
+{
+  return _saved != 0;
+}
+
+timer::SBenchOptions::SBenchOptions()
+  : warmup( 0.1 )
+  , min_sample( 0.0 )
+  , min_samples( 10 )
+  , max_samples( 100000 )
+  , max_time( 5.0 )
+  , precision( 0.01 )
+  , cpu( -1 )
+{
+}
+
+timer::BenchResult::BenchResult( const std::string& name,
+  uint64_t batch,
+  const SeriesTimer& samples )
+  : _name( name )
+  , _batch( batch )
+  , _samples( samples )
+{
+}
+
+const std::string&
+timer::BenchResult::name() const
+{
+  return _name;
+}
+
+uint64_t
+timer::BenchResult::batch() const
+{
+  return _batch;
+}
+
+const timer::SeriesTimer&
+timer::BenchResult::samples() const
+{
+  return _samples;
+}
+
+double
+timer::BenchResult::mean( Stopwatch::timeunit_t timeunit ) const
+{
+  return _samples.mean( timeunit ) / _batch;
+}
+
+double
+timer::BenchResult::median( Stopwatch::timeunit_t timeunit ) const
+{
+  return _samples.size() > 0 ? _samples.quantile( 0.5, timeunit ) / _batch : 0.0;
+}
+
+double
+timer::BenchResult::std( Stopwatch::timeunit_t timeunit ) const
+{
+  return _samples.std( timeunit ) / _batch;
+}
+
+double
+timer::BenchResult::confidence( Stopwatch::timeunit_t timeunit ) const
+{
+  size_t n = _samples.size();
+  if ( n < 2 )
+  {
+    return 0.0;
+  }
+  // sample standard deviation from the population one of SeriesTimer
+  double s = std( timeunit ) * std::sqrt( 1.0 * n / ( n - 1 ) );
+  return 1.96 * s / std::sqrt( 1.0 * n );
+}
+
+void
+timer::BenchResult::print( const char* msg, Stopwatch::timeunit_t timeunit, std::ostream& os ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+
+  const char* unit = "";
+  switch ( timeunit )
+  {
+    case Stopwatch::MICROSEC:
+      unit = " microsec.";
+      break;
+    case Stopwatch::MILLISEC:
+      unit = " millisec.";
+      break;
+    case Stopwatch::SECONDS:
+      unit = " sec.";
+      break;
+    case Stopwatch::MINUTES:
+      unit = " min.";
+      break;
+    case Stopwatch::HOURS:
+      unit = " h.";
+      break;
+    case Stopwatch::DAYS:
+      unit = " days.";
+      break;
+  }
+  double m = mean( timeunit );
+  os << msg << _name << ": " << m << unit << " +- "
+     << ( m > 0.0 ? 100.0 * confidence( timeunit ) / m : 0.0 ) << "% (mean, 95% CI), median "
+     << median( timeunit ) << unit << ", std " << std( timeunit ) << unit << " ("
+     << _samples.size() << " samples x " << _batch << " calls)" << std::endl;
+}
@@ -0,0 +1,79 @@
+/**
+ * bench_collector.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * Measures the cost of a ScopeTimer with 1, 2, 4, ... threads, that
+ * record concurrently, i.e. how registering with the collector scales.
+ * The number of ScopeTimer per thread and the maximal number of threads
+ * can be passed as first and second argument.
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "scopetimer.hpp"
+#include "stopwatch.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+using namespace timer;
+
+int
+main( int argc, char const** argv )
+{
+  uint64_t n = argc > 1 ? strtoull( argv[ 1 ], 0, 10 ) : 1000000;
+#ifdef _OPENMP
+  int max_threads = argc > 2 ? atoi( argv[ 2 ] ) : omp_get_num_procs();
+#else
+  int max_threads = 1;
+#endif
+  const string names[ 4 ] = { "parse", "lookup", "update", "respond" };
+
+  cout << setw( 8 ) << "threads" << setw( 18 ) << "ns / ScopeTimer" << setw( 22 )
+       << "ScopeTimer / sec." << endl;
+  for ( int threads = 1; threads <= max_threads; threads *= 2 )
+  {
+    Stopwatch outer;
+    outer.start();
+#pragma omp parallel num_threads( threads )
+    {
+      for ( uint64_t i = 0; i < n; ++i )
+      {
+        ScopeTimer t( names[ i % 4 ] );
+      }
+    }
+    outer.stop();
+    double elapsed = outer.elapsed( Stopwatch::MICROSEC );
+    cout << setw( 8 ) << threads << setw( 18 ) << setprecision( 4 ) << elapsed * 1000.0 / n
+         << setw( 22 ) << setprecision( 4 ) << threads * n / elapsed * Stopwatch::SECONDS << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,132 @@
+/**
+ * bench_overhead.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * Measures the cost of a single measurement with the different timers,
+ * i.e. of an empty start/stop pair. Run without arguments; the number
+ * of measurements can be passed as first argument.
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "laptimer.hpp"
+#include "measure.hpp"
+#include "seriestimer.hpp"
+#include "stopwatch.hpp"
+
+using namespace std;
+using namespace timer;
+
+namespace
+{
+void
+report( const char* name, const Stopwatch& outer, uint64_t n )
+{
+  cout << setw( 30 ) << name << " :: " << setw( 8 ) << setprecision( 4 )
+       << outer.elapsed( Stopwatch::MICROSEC ) * 1000.0 / n << " ns / measurement" << endl;
+}
+}
+
+int
+main( int argc, char const** argv )
+{
+  uint64_t n = argc > 1 ? strtoull( argv[ 1 ], 0, 10 ) : 10000000;
+  Stopwatch outer;
+
+  {
+    Stopwatch::timestamp_t sink = 0;
+    outer.reset();
+    outer.start();
+    for ( uint64_t i = 0; i < n; ++i )
+    {
+      sink += Stopwatch::get_timestamp();
+    }
+    outer.stop();
+    report( "Stopwatch::get_timestamp", outer, n );
+    if ( sink == 42 )
+    {
+      cout << sink << endl;
+    }
+  }
+
+  {
+    Stopwatch x;
+    outer.reset();
+    outer.start();
+    for ( uint64_t i = 0; i < n; ++i )
+    {
+      x.start();
+      x.stop();
+    }
+    outer.stop();
+    report( "Stopwatch start/stop", outer, n );
+  }
+
+  {
+    SeriesTimer x;
+    outer.reset();
+    outer.start();
+    for ( uint64_t i = 0; i < n; ++i )
+    {
+      x.start();
+      x.stop();
+    }
+    outer.stop();
+    report( "SeriesTimer start/stop", outer, n );
+  }
+
+  {
+    SeriesTimer x;
+    outer.reset();
+    outer.start();
+    for ( uint64_t i = 0; i < n; ++i )
+    {
+      ScopedMeasure< SeriesTimer > g( x );
+    }
+    outer.stop();
+    report( "ScopedMeasure< SeriesTimer >", outer, n );
+  }
+
+  {
+    LapTimer< 4 > x;
+    outer.reset();
+    outer.start();
+    for ( uint64_t i = 0; i < n; i += 4 )
+    {
+      x.start();
+      x.lap();
+      x.lap();
+      x.lap();
+      x.lap();
+    }
+    outer.stop();
+    report( "LapTimer< 4 > lap", outer, n );
+  }
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+/**
+ * bootstrap.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "bootstrap.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+timer::detail::Random::Random( uint64_t seed )
+{
+  // splitmix64 of the seed, such that neighbouring seeds diverge and
+  // the state is never 0
+  uint64_t z = seed + 0x9e3779b97f4a7c15ULL;
+  z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+  z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+  _state = ( z ^ ( z >> 31 ) ) | 1;
+}
+
+uint64_t
+timer::detail::Random::next()
+{
+  _state ^= _state >> 12;
+  _state ^= _state << 25;
+  _state ^= _state >> 27;
+  return _state * 0x2545f4914f6cdd1dULL;
+}
+
+size_t
+timer::detail::Random::below( size_t n )
+{
+  // the upper 32 bits scaled to [0, n); the bias is negligible
+  // for n much smaller than 2^32
+  return ( size_t )( ( ( next() >> 32 ) * n ) >> 32 );
+}
+
+double
+timer::detail::Random::uniform()
+{
+  // 53 random bits, shifted away from 0
+  return ( ( next() >> 11 ) + 0.5 ) / 9007199254740992.0;
+}
+
+double
+timer::detail::Random::normal()
+{
+  // Box-Muller
+  const double pi = 3.14159265358979323846;
+  return std::sqrt( -2.0 * std::log( uniform() ) ) * std::cos( 2.0 * pi * uniform() );
+}
+
+double
+timer::detail::Random::gamma( double shape )
+{
+  assert( shape >= 1.0 );
+  // Marsaglia and Tsang, "A simple method for generating gamma variables"
+  const double d = shape - 1.0 / 3.0;
+  const double c = 1.0 / std::sqrt( 9.0 * d );
+  for ( ;; )
+  {
+    double x = normal();
+    double v = 1.0 + c * x;
+    if ( v <= 0.0 )
+    {
+      continue;
+    }
+    v = v * v * v;
+    if ( std::log( uniform() ) < 0.5 * x * x + d - d * v + d * std::log( v ) )
+    {
+      return d * v;
+    }
+  }
+}
+
+double
+timer::detail::Random::beta( double a, double b )
+{
+  double x = gamma( a );
+  return x / ( x + gamma( b ) );
+}
+
+size_t
+timer::detail::quantile_index( double q, size_t n )
+{
+  assert( n > 0 );
+  int64_t i = ( int64_t ) std::ceil( q * n ) - 1;
+  return i < 0 ? 0 : ( size_t ) i;
+}
+
+void
+timer::detail::bootstrap_quantiles( const std::vector< Stopwatch::timestamp_t >& sorted,
+  const std::vector< double >& qs,
+  size_t resamples,
+  uint64_t seed,
+  std::vector< double >& quantiles )
+{
+  assert( not sorted.empty() );
+  std::vector< size_t > ranks;
+  bootstrap_ranks( sorted.size(), qs, resamples, seed, ranks );
+  quantiles.resize( ranks.size() );
+  for ( size_t i = 0; i < ranks.size(); ++i )
+  {
+    quantiles[ i ] = 1.0 * sorted[ ranks[ i ] ];
+  }
+}
+
+void
+timer::detail::bootstrap_ranks( size_t n,
+  const std::vector< double >& qs,
+  size_t resamples,
+  uint64_t seed,
+  std::vector< size_t >& ranks )
+{
+  assert( n > 0 );
+  const size_t nq = qs.size();
+  ranks.assign( resamples * nq, 0 );
+
+#pragma omp parallel for schedule( static )
+  for ( int64_t r = 0; r < ( int64_t ) resamples; ++r )
+  {
+    Random random( seed ^ ( ( uint64_t ) r * 0x9e3779b97f4a7c15ULL ) );
+    for ( size_t i = 0; i < nq; ++i )
+    {
+      double k = quantile_index( qs[ i ], n );
+      size_t j = ( size_t )( n * random.beta( k + 1.0, n - k ) );
+      ranks[ r * nq + i ] = std::min( j, n - 1 );
+    }
+  }
+}
+
+namespace
+{
+void
+select( std::vector< timer::Stopwatch::timestamp_t >::iterator first,
+  std::vector< timer::Stopwatch::timestamp_t >::iterator base,
+  std::vector< timer::Stopwatch::timestamp_t >::iterator last,
+  std::vector< size_t >::const_iterator rank_first,
+  std::vector< size_t >::const_iterator rank_last )
+{
+  if ( rank_first == rank_last )
+  {
+    return;
+  }
+  // select the middle rank, then the ranks left and right of it
+  // in the respective partitions
+  std::vector< size_t >::const_iterator mid = rank_first + ( rank_last - rank_first ) / 2;
+  std::vector< timer::Stopwatch::timestamp_t >::iterator pivot = base + *mid;
+  std::nth_element( first, pivot, last );
+  select( first, base, pivot, rank_first, mid );
+  select( pivot + 1, base, last, mid + 1, rank_last );
+}
+}
+
+void
+timer::detail::select_ranks( std::vector< Stopwatch::timestamp_t >& values,
+  std::vector< size_t > ranks )
+{
+  std::sort( ranks.begin(), ranks.end() );
+  ranks.erase( std::unique( ranks.begin(), ranks.end() ), ranks.end() );
+  assert( ranks.empty() || ranks.back() < values.size() );
+  select( values.begin(), values.begin(), values.end(), ranks.begin(), ranks.end() );
+}
+
+double
+timer::detail::percentile( std::vector< double >& values, double q )
+{
+  assert( not values.empty() );
+  double pos = q * ( values.size() - 1 );
+  size_t lo = ( size_t ) std::floor( pos );
+  size_t hi = std::min( lo + 1, values.size() - 1 );
+  std::nth_element( values.begin(), values.begin() + lo, values.end() );
+  double vlo = values[ lo ];
+  if ( hi == lo )
+  {
+    return vlo;
+  }
+  double vhi = *std::min_element( values.begin() + hi, values.end() );
+  return vlo + ( pos - lo ) * ( vhi - vlo );
+}
@@ -0,0 +1,136 @@
+/**
+ * bootstrap.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * Internal helpers for resampling statistics; not installed.
+ */
+
+#ifndef BOOTSTRAP_H
+#define BOOTSTRAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "stopwatch.hpp"
+
+namespace timer
+{
+namespace detail
+{
+
+/**
+ * Small and fast pseudo random numbers (xorshift64*), one
+ * generator per thread.
+ */
+class Random
+{
+public:
+  explicit Random( uint64_t seed );
+
+  /**
+   * Returns the next 64 bit random number.
+   */
+  uint64_t next();
+
+  /**
+   * Returns a random number in [0, n).
+   */
+  size_t below( size_t n );
+
+  /**
+   * Returns a uniformly distributed number in (0, 1).
+   */
+  double uniform();
+
+  /**
+   * Returns a standard normal distributed number.
+   */
+  double normal();
+
+  /**
+   * Returns a Gamma( shape, 1 ) distributed number, shape >= 1.
+   */
+  double gamma( double shape );
+
+  /**
+   * Returns a Beta( a, b ) distributed number, a, b >= 1.
+   */
+  double beta( double a, double b );
+
+private:
+  uint64_t _state;
+};
+
+/**
+ * Returns the index of the q-th quantile in 'n' sorted values;
+ * in doubt the smaller one.
+ */
+size_t quantile_index( double q, size_t n );
+
+/**
+ * Draws the rank of the 'qs'[ i ]-th quantile of 'resamples' bootstrap
+ * resamples (with replacement) of 'n' values, and stores it in
+ * ranks[ r * qs.size() + i ]. The value with rank k (from 0) of a
+ * resample is the value with rank floor( n * B ) of the original
+ * values, with B ~ Beta( k + 1, n - k ), the distribution of the
+ * (k + 1)-th smallest of n uniform numbers; hence each draw is O(1)
+ * instead of O(n). The quantiles of one resample are drawn
+ * independently, which is exact for each quantile on its own. The
+ * draws run in parallel (OpenMP); the result only depends on 'seed'.
+ */
+void bootstrap_ranks( size_t n,
+  const std::vector< double >& qs,
+  size_t resamples,
+  uint64_t seed,
+  std::vector< size_t >& ranks );
+
+/**
+ * Like bootstrap_ranks(), but stores the quantiles of the sorted,
+ * non-empty 'sorted' instead of their ranks.
+ */
+void bootstrap_quantiles( const std::vector< Stopwatch::timestamp_t >& sorted,
+  const std::vector< double >& qs,
+  size_t resamples,
+  uint64_t seed,
+  std::vector< double >& quantiles );
+
+/**
+ * Reorders 'values', such that values[ r ] is the value with rank r
+ * for all 'ranks' (multi-selection: O(n log ranks.size()) instead of
+ * sorting).
+ */
+void select_ranks( std::vector< Stopwatch::timestamp_t >& values, std::vector< size_t > ranks );
+
+/**
+ * Returns the q-th quantile of 'values' (in any order), interpolated
+ * between the neighbouring order statistics. Reorders 'values'.
+ */
+double percentile( std::vector< double >& values, double q );
+
+} /* namespace detail */
+} /* namespace timer */
+#endif /* BOOTSTRAP_H */
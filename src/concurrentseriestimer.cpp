@@ -0,0 +1,200 @@
+/**
+ * concurrentseriestimer.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "concurrentseriestimer.hpp"
+#include "localmemory.hpp"
+
+
+namespace timer
+{
+std::ostream&
+operator<<( std::ostream& os, const ConcurrentSeriesTimer& timer )
+{
+  timer.print( "", Stopwatch::SECONDS, os );
+  return os;
+}
+}
+
+timer::ConcurrentSeriesTimer::ConcurrentSeriesTimer()
+{
+#ifdef ENABLE_TIMING
+  _buffers = new detail::SlotTable< SThreadBuffer >();
+#endif
+}
+
+timer::ConcurrentSeriesTimer::~ConcurrentSeriesTimer()
+{
+#ifdef ENABLE_TIMING
+  reset();
+  for ( size_t i = 0; i < _buffers->size(); ++i )
+  {
+    detail::local_delete( _buffers->get( i ) );
+  }
+  delete _buffers;
+#endif
+}
+
+timer::ConcurrentSeriesTimer::token_t
+timer::ConcurrentSeriesTimer::start() const
+{
+#ifdef ENABLE_TIMING
+  return Stopwatch::get_timestamp();
+#else
+  return 0;
+#endif
+}
+
+void
+timer::ConcurrentSeriesTimer::stop( token_t token )
+{
+#ifdef ENABLE_TIMING
+  record( Stopwatch::get_timestamp() - token );
+#else
+  ( void ) token;
+#endif
+}
+
+void
+timer::ConcurrentSeriesTimer::record( Stopwatch::timestamp_t elapsed )
+{
+#ifdef ENABLE_TIMING
+  SThreadBuffer** entry = _buffers->entry( detail::thread_slot() );
+  if ( *entry == 0 )
+  {
+    // allocated by the thread itself, hence in its local memory
+    SThreadBuffer* created = detail::local_new< SThreadBuffer >();
+    created->fill = CHUNK_SIZE;
+    __atomic_store_n( entry, created, __ATOMIC_RELEASE );
+  }
+  SThreadBuffer& buffer = **entry;
+  if ( buffer.fill == CHUNK_SIZE )
+  {
+    // chunks are never reallocated; a full chunk is followed by a new one
+    buffer.chunks.push_back( new Stopwatch::timestamp_t[ CHUNK_SIZE ] );
+    buffer.fill = 0;
+  }
+  buffer.chunks.back()[ buffer.fill++ ] = elapsed;
+#else
+  ( void ) elapsed;
+#endif
+}
+
+void
+timer::ConcurrentSeriesTimer::reset()
+{
+#ifdef ENABLE_TIMING
+  for ( size_t i = 0; i < _buffers->size(); ++i )
+  {
+    SThreadBuffer* buffer = _buffers->get( i );
+    if ( buffer == 0 )
+    {
+      continue;
+    }
+    for ( size_t c = 0; c < buffer->chunks.size(); ++c )
+    {
+      delete[] buffer->chunks[ c ];
+    }
+    buffer->chunks.clear();
+    buffer->fill = CHUNK_SIZE;
+  }
+#endif
+}
+
+size_t
+timer::ConcurrentSeriesTimer::size() const
+{
+#ifdef ENABLE_TIMING
+  size_t result = 0;
+  for ( size_t i = 0; i < _buffers->size(); ++i )
+  {
+    const SThreadBuffer* buffer = _buffers->get( i );
+    if ( buffer != 0 && not buffer->chunks.empty() )
+    {
+      result += ( buffer->chunks.size() - 1 ) * CHUNK_SIZE + buffer->fill;
+    }
+  }
+  return result;
+#else
+  return 0;
+#endif
+}
+
+timer::SeriesTimer
+timer::ConcurrentSeriesTimer::series( SeriesTimer::storage_t storage ) const
+{
+  SeriesTimer result( storage );
+#ifdef ENABLE_TIMING
+  for ( size_t i = 0; i < _buffers->size(); ++i )
+  {
+    if ( _buffers->get( i ) == 0 )
+    {
+      continue;
+    }
+    const SThreadBuffer& buffer = *_buffers->get( i );
+    for ( size_t c = 0; c < buffer.chunks.size(); ++c )
+    {
+      size_t n = c + 1 == buffer.chunks.size() ? buffer.fill : ( size_t ) CHUNK_SIZE;
+      for ( size_t j = 0; j < n; ++j )
+      {
+        result.record( buffer.chunks[ c ][ j ] );
+      }
+    }
+  }
+#endif
+  return result;
+}
+
+double
+timer::ConcurrentSeriesTimer::sum( Stopwatch::timeunit_t timeunit ) const
+{
+  return series().sum( timeunit );
+}
+
+double
+timer::ConcurrentSeriesTimer::mean( Stopwatch::timeunit_t timeunit ) const
+{
+  return series().mean( timeunit );
+}
+
+double
+timer::ConcurrentSeriesTimer::std( Stopwatch::timeunit_t timeunit ) const
+{
+  return series().std( timeunit );
+}
+
+double
+timer::ConcurrentSeriesTimer::quantile( double q, Stopwatch::timeunit_t timeunit ) const
+{
+  return series().quantile( q, timeunit );
+}
+
+void
+timer::ConcurrentSeriesTimer::print( const char* msg,
+  Stopwatch::timeunit_t timeunit,
+  std::ostream& os ) const
+{
+  series().print( msg, timeunit, os );
+}
@@ -26,6 +26,8 @@
 
 #include <iostream>
 
+#include "bench.hpp"
+#include "concurrentseriestimer.hpp"
 #include "scopetimer.hpp"
 #include "seriestimer.hpp"
 #include "stopwatch.hpp"
@@ -45,35 +47,47 @@ fib( size_t n )
   return fib( n - 1 ) + fib( n - 2 );
 }
 
+struct Fib
+{
+  size_t n;
+
+  void
+  operator()() const
+  {
+    do_not_optimize( fib( n ) );
+  }
+};
+
 int
 main( int32_t, char const** )
 {
-  SeriesTimer y;
+  ConcurrentSeriesTimer y;
 #pragma omp parallel num_threads( 4 )
   {
-    ScopeTimer f( "fib" );
+    ScopeTimer f( "fib", ScopeTimer::CPUTIME );
     Stopwatch x;
+    ConcurrentSeriesTimer::token_t t;
 
 
-    y.start();
+    t = y.start();
     x.start();
     fib( 43 );
     x.stop();
-    y.stop();
+    y.stop( t );
 
     x.print( "First fib time = " );
 
-    y.start();
+    t = y.start();
     x.start(); // resume
     fib( 43 );
     x.print( "Some intermediate: " );
     x.stop();
-    y.stop();
+    y.stop( t );
 
     x.print( "First & Second fib time = " );
 
     cout << "Time for 3 fib ... " << endl;
-    y.start();
+    t = y.start();
     x.start(); // resume
     fib( 43 );
     x.stop();
@@ -83,7 +97,7 @@ main( int32_t, char const** )
     x.print( "", Stopwatch::MINUTES );
     x.print( "", Stopwatch::HOURS );
     x.print( "", Stopwatch::DAYS, cerr );
-    y.stop();
+    y.stop( t );
 
     x.reset();
     x.start(); // start from new
@@ -95,10 +109,10 @@ main( int32_t, char const** )
     ScopeTimer ot( "outside for-loop" );
     for ( int32_t i = 0; i < 5; ++i )
     {
-      ScopeTimer t( "in for-loop" );
-      y.start();
+      ScopeTimer t( "in for-loop", ScopeTimer::CPUTIME );
+      ConcurrentSeriesTimer::token_t token = y.start();
       usleep( 831234 ); // ... do computations for 5.83 sec each
-      y.stop();
+      y.stop( token );
     }
   }
   y.print( "Hi" );
@@ -113,5 +127,9 @@ main( int32_t, char const** )
     }
     x.print( "Timings: " );
   }
+  {
+    Fib f = { 20 };
+    bench( "fib(20)", f ).print();
+  }
   return 0;
 }
@@ -0,0 +1,267 @@
+/**
+ * bench.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cmath>
+#include <iostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "seriestimer.hpp"
+#include "stopwatch.hpp"
+#include "timer_config.hpp"
+
+namespace timer
+{
+
+/**
+ * Prevents the compiler from optimizing away the computation of 'value'.
+ */
+template < class T >
+inline void
+do_not_optimize( T const& value )
+{
+#if defined( __GNUC__ )
+  asm volatile( "" : : "r,m"( value ) : "memory" );
+#else
+  const volatile char* p = reinterpret_cast< const volatile char* >( &value );
+  ( void ) *p;
+#endif
+}
+
+/**
+ * Forces the compiler to write all pending stores to memory.
+ */
+inline void
+clobber_memory()
+{
+#if defined( __GNUC__ )
+  asm volatile( "" : : : "memory" );
+#endif
+}
+
+/**
+ * Pins the calling thread to 'cpu'. Returns false, if not supported
+ * or not possible. The previous affinity is not restored; see CpuPin.
+ */
+bool pin_to_cpu( int cpu );
+
+/**
+ * Pins the calling thread to a cpu for the lifetime of the CpuPin,
+ * and restores the previous affinity of the thread afterwards.
+ */
+class CpuPin
+{
+public:
+  /**
+   * Pins the calling thread to 'cpu'; -1: no pinning.
+   */
+  explicit CpuPin( int cpu );
+
+  ~CpuPin();
+
+  /**
+   * Returns, whether the thread is pinned.
+   */
+  bool pinned() const;
+
+private:
+  CpuPin( const CpuPin& );         // Don't Implement
+  void operator=( const CpuPin& ); // Don't implement
+
+  void* _saved; // previous affinity (cpu_set_t), if pinned
+};
+
+/**
+ * Settings of the benchmark runner.
+ */
+struct SBenchOptions
+{
+  double warmup;      // minimal warmup time in sec.
+  double min_sample;  // minimal duration of one sample in microsec.; 0: 1000x clock resolution
+  size_t min_samples; // samples before checking the precision
+  size_t max_samples; // stop after this many samples
+  double max_time;    // stop after this many sec. of sampling
+  double precision;   // stop if the 95% CI of the mean is within +-precision * mean
+  int cpu;            // pin the benchmark to this cpu during the run; -1: no pinning
+
+  SBenchOptions();
+};
+
+/************************************************************************
+ * BenchResult                                                          *
+ *   Result of a benchmark run with bench(): the samples are the        *
+ *   durations of batches of 'batch()' calls, all statistics are        *
+ *   returned per call.                                                 *
+ ************************************************************************/
+class BenchResult
+{
+public:
+  BenchResult( const std::string& name, uint64_t batch, const SeriesTimer& samples );
+
+  /**
+   * Returns the name of the benchmark.
+   */
+  const std::string& name() const;
+
+  /**
+   * Returns the number of calls per sample.
+   */
+  uint64_t batch() const;
+
+  /**
+   * Returns the durations of the samples (of batch() calls each).
+   */
+  const SeriesTimer& samples() const;
+
+  /**
+   * Returns the average time per call.
+   */
+  double mean( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the median time per call.
+   */
+  double median( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the standard deviation of the time per call.
+   */
+  double std( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the half-width of the 95% confidence interval of the mean.
+   */
+  double confidence( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * This method prints out a one line summary.
+   */
+  void print( const char* msg = "",
+    Stopwatch::timeunit_t timeunit = Stopwatch::MICROSEC,
+    std::ostream& os = std::cout ) const;
+
+  /**
+   * Convenient method for writing the summary in microseconds
+   * to some ostream.
+   */
+  friend std::ostream& operator<<( std::ostream& os, const BenchResult& result );
+
+private:
+  std::string _name;
+  uint64_t _batch;
+  SeriesTimer _samples;
+};
+
+/**
+ * Times 'batch' calls of 'function' and returns the elapsed microseconds.
+ */
+template < class Function >
+inline Stopwatch::timestamp_t
+run_batch( Function& function, uint64_t batch )
+{
+  Stopwatch::timestamp_t begin = Stopwatch::get_timestamp();
+  for ( uint64_t i = 0; i < batch; ++i )
+  {
+    function();
+  }
+  clobber_memory();
+  return Stopwatch::get_timestamp() - begin;
+}
+
+/************************************************************************
+ * bench                                                                *
+ *   Runs 'function' repeatedly and returns its timings:                *
+ *     1. warmup, while doubling the number of calls per sample         *
+ *        (batch), until one batch takes at least min_sample (or the    *
+ *        batch reaches 2^40 calls, e.g. for empty functions),          *
+ *     2. sampling of batches into a SeriesTimer, until the 95%         *
+ *        confidence interval of the mean is tight enough, or the       *
+ *        limits of samples or time are reached.                        *
+ *   Use do_not_optimize() on results computed in 'function'.           *
+ *                                                                      *
+ *   Usage example:                                                     *
+ *     BenchResult r = bench( "fib(20)", [] {                           *
+ *       do_not_optimize( fib( 20 ) );                                  *
+ *     } );                                                             *
+ *     r.print();                                                       *
+ *     // fib(20): 25.31 microsec. +- 0.21% (mean, 95% CI), median ...  *
+ ************************************************************************/
+template < class Function >
+BenchResult
+bench( const std::string& name, Function function, const SBenchOptions& options = SBenchOptions() )
+{
+  CpuPin pin( options.cpu );
+
+  double min_sample
+    = options.min_sample > 0.0 ? options.min_sample : 1000.0 * Stopwatch::resolution();
+  uint64_t batch = 1;
+  Stopwatch warmup;
+  warmup.start();
+  for ( ;; )
+  {
+    Stopwatch::timestamp_t elapsed = run_batch( function, batch );
+    if ( elapsed < min_sample && batch < ( ( uint64_t ) 1 << 40 ) )
+    {
+      batch *= 2;
+    }
+    else if ( warmup.elapsed() >= options.warmup )
+    {
+      break;
+    }
+  }
+
+  // running mean and variance (Welford), to check the precision in O(1)
+  SeriesTimer samples;
+  double mean = 0.0;
+  double m2 = 0.0;
+  Stopwatch total;
+  total.start();
+  for ( size_t n = 1; n <= options.max_samples; ++n )
+  {
+    Stopwatch::timestamp_t elapsed = run_batch( function, batch );
+    samples.record( elapsed );
+
+    double delta = elapsed - mean;
+    mean += delta / n;
+    m2 += delta * ( elapsed - mean );
+    if ( n >= options.min_samples && n > 1 )
+    {
+      double half_width = 1.96 * std::sqrt( m2 / ( n - 1 ) / n );
+      if ( half_width <= options.precision * mean || total.elapsed() >= options.max_time )
+      {
+        break;
+      }
+    }
+  }
+  return BenchResult( name, batch, samples );
+}
+
+} /* namespace timer */
+#endif /* BENCH_H */
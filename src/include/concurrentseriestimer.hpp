@@ -0,0 +1,188 @@
+/**
+ * concurrentseriestimer.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef CONCURRENT_SERIES_TIMER_H
+#define CONCURRENT_SERIES_TIMER_H
+
+#include <iostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "measure.hpp"
+#include "seriestimer.hpp"
+#include "stopwatch.hpp"
+#include "timer_config.hpp"
+
+namespace timer
+{
+namespace detail
+{
+template < class T >
+class SlotTable;
+}
+
+/************************************************************************
+ * ConcurrentSeriesTimer                                                *
+ *   A SeriesTimer that can be shared among threads, e.g. of an OpenMP  *
+ *   team. start() returns a token with the begin of the measurement,   *
+ *   that is handed back to stop(), hence no in-flight state is shared. *
+ *   Each thread appends its timings to its own chunked buffer (no      *
+ *   locks, no reallocation); the buffers are combined on query. A      *
+ *   thread allocates its buffer at its first timing, in memory of its  *
+ *   NUMA node.                                                         *
+ *                                                                      *
+ *   Thread-safe for recording (start, stop, record) by any threads     *
+ *   (OpenMP, pthreads or std::thread). Query the timings after         *
+ *   recording finished, e.g. after the parallel region.                *
+ *                                                                      *
+ *   Usage example:                                                     *
+ *     ConcurrentSeriesTimer x;                                         *
+ *     #pragma omp parallel for                                         *
+ *     for (int32_t i = 0; i < 1000; ++i)                               *
+ *     {                                                                *
+ *         ConcurrentSeriesTimer::token_t t = x.start();                *
+ *         // do computation ...                                        *
+ *         x.stop( t );                                                 *
+ *     }                                                                *
+ *     x.print("Timings: ");                                            *
+ ************************************************************************/
+class ConcurrentSeriesTimer
+{
+public:
+  typedef Stopwatch::timestamp_t token_t;
+
+  enum
+  {
+    CHUNK_SIZE = 4096
+  };
+
+  /**
+   * Creates a ConcurrentSeriesTimer for any number of threads.
+   */
+  ConcurrentSeriesTimer();
+
+  ~ConcurrentSeriesTimer();
+
+  /**
+   * Begins a new measurement and returns its token.
+   */
+  token_t start() const;
+
+  /**
+   * Stops the measurement started with 'token' and stores the
+   * resulting time in the buffer of the calling thread.
+   */
+  void stop( token_t token );
+
+  /**
+   * Adds a timing, that was measured elsewhere, to the buffer
+   * of the calling thread.
+   */
+  void record( Stopwatch::timestamp_t elapsed );
+
+  /**
+   * Returns a guard, that adds the time until the end of its scope
+   * to the buffer of the calling thread.
+   */
+  ScopedMeasure< ConcurrentSeriesTimer > scoped();
+
+  /**
+   * Resets the ConcurrentSeriesTimer. Not thread-safe.
+   */
+  void reset();
+
+  /**
+   * Returns the number of timings of all threads.
+   */
+  size_t size() const;
+
+  /**
+   * Returns the combined timings of all threads as a SeriesTimer.
+   */
+  SeriesTimer series( SeriesTimer::storage_t storage = SeriesTimer::RAW ) const;
+
+  /**
+   * Returns the total elapsed time of the series.
+   */
+  double sum( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the average time of the series.
+   */
+  double mean( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the standard deviation time of the series.
+   */
+  double std( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the q-th quantile timing of the series.
+   */
+  double quantile( double q = 0.5, Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * This method prints out the combined timings and their statistics.
+   */
+  void print( const char* msg = "",
+    Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS,
+    std::ostream& os = std::cout ) const;
+
+  /**
+   * Convenient method for writing time in seconds
+   * to some ostream.
+   */
+  friend std::ostream& operator<<( std::ostream& os, const ConcurrentSeriesTimer& timer );
+
+private:
+#ifdef ENABLE_TIMING
+  /**
+   * Timings of one thread. Cache line aligned and padded, such that
+   * the threads do not write to shared lines.
+   */
+  struct SThreadBuffer
+  {
+    std::vector< Stopwatch::timestamp_t* > chunks;
+    size_t fill;
+    char pad[ 64 - sizeof( std::vector< Stopwatch::timestamp_t* > ) - sizeof( size_t ) ];
+  };
+
+  detail::SlotTable< SThreadBuffer >* _buffers; // per thread, created on first use
+#endif
+
+  ConcurrentSeriesTimer( ConcurrentSeriesTimer const& ); // Don't Implement
+  void operator=( ConcurrentSeriesTimer const& );        // Don't implement
+};
+
+inline ScopedMeasure< ConcurrentSeriesTimer >
+ConcurrentSeriesTimer::scoped()
+{
+  return ScopedMeasure< ConcurrentSeriesTimer >( *this );
+}
+
+} /* namespace timer */
+#endif /* CONCURRENT_SERIES_TIMER_H */
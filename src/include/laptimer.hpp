@@ -0,0 +1,456 @@
+/**
+ * laptimer.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef LAP_TIMER_H
+#define LAP_TIMER_H
+
+#include <cassert>
+#include <iomanip>
+#include <iostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "seriestimer.hpp"
+#include "stopwatch.hpp"
+#include "timer_config.hpp"
+
+namespace timer
+{
+
+/************************************************************************
+ * LapTimer                                                             *
+ *   Times up to N consecutive phases with one clock read per phase     *
+ *   boundary: start() begins the first phase, each lap() ends the      *
+ *   current phase and begins the next. The durations are kept in an    *
+ *   inline array, hence no allocation; feed them into a                *
+ *   PhaseBreakdown for statistics over many runs.                      *
+ *                                                                      *
+ *   Usage example:                                                     *
+ *     LapTimer< 4 > laps;                                              *
+ *     laps.start();                                                    *
+ *     parse();                                                         *
+ *     laps.lap();                                                      *
+ *     plan();                                                          *
+ *     laps.lap();                                                      *
+ *     execute();                                                       *
+ *     laps.lap();                                                      *
+ *     serialize();                                                     *
+ *     laps.lap();                                                      *
+ *     cout << "execute: " << laps.phase( 2 ) << " sec." << endl;       *
+ ************************************************************************/
+template < size_t N >
+class LapTimer
+{
+public:
+  /**
+   * Creates a LapTimer without phases.
+   */
+  LapTimer();
+
+  /**
+   * Discards the phases and begins the first one.
+   */
+  void start();
+
+  /**
+   * Ends the current phase and begins the next one. Laps beyond N
+   * are not kept. Requires start() first: a lap before is ignored (it
+   * has no phase to end), and asserts in debug builds.
+   */
+  void lap();
+
+  /**
+   * Returns the number of completed phases.
+   */
+  size_t laps() const;
+
+  /**
+   * Returns the duration of the completed phase 'i' in microseconds.
+   */
+  Stopwatch::timestamp_t phase_timestamp( size_t i ) const;
+
+  /**
+   * Returns the duration of the completed phase 'i'.
+   */
+  double phase( size_t i, Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the duration of all completed phases.
+   */
+  double total( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Discards the phases.
+   */
+  void reset();
+
+private:
+#ifdef ENABLE_TIMING
+  Stopwatch::timestamp_t _last; // begin of the current phase; 0: not started
+  size_t _laps;
+  Stopwatch::timestamp_t _phases[ N ];
+#endif
+};
+
+/************************************************************************
+ * PhaseBreakdown                                                       *
+ *   Accumulates the phases of many LapTimer< N > runs, e.g. of the     *
+ *   stages of a request pipeline, in one SeriesTimer per phase and     *
+ *   one for the total, and prints the per-phase statistics with the    *
+ *   share of each phase in the total. Runs with fewer than N laps are  *
+ *   only counted, such that all phases and the total cover the same    *
+ *   runs.                                                              *
+ *                                                                      *
+ *   Usage example:                                                     *
+ *     const char* names[] = { "parse", "plan", "execute",              *
+ *                             "serialize" };                           *
+ *     PhaseBreakdown< 4 > breakdown( names, SeriesTimer::PACKED );     *
+ *     // per request, with the LapTimer above:                         *
+ *     breakdown.add( laps );                                           *
+ *     // ...                                                           *
+ *     breakdown.print( "Requests", Stopwatch::MICROSEC );              *
+ *     // Requests (microsec), 1000000 runs:                            *
+ *     //      parse :: mean 12.1 p50 11 p99 30 max 412 (9.8%)          *
+ *     //       plan :: mean 20.4 p50 19 p99 51 max 733 (16.5%)         *
+ *     //    ...                                                        *
+ ************************************************************************/
+template < size_t N >
+class PhaseBreakdown
+{
+public:
+  /**
+   * Creates an empty breakdown of N phases named 'names', which are
+   * recorded with 'storage'.
+   */
+  explicit PhaseBreakdown( const char* const* names,
+    SeriesTimer::storage_t storage = SeriesTimer::RAW );
+
+  /**
+   * Records the phases of 'laps' and their total, if all N phases are
+   * completed; otherwise only counts the run as incomplete.
+   */
+  void add( const LapTimer< N >& laps );
+
+  /**
+   * Returns the number of skipped runs with fewer than N laps.
+   */
+  uint64_t incomplete() const;
+
+  /**
+   * Returns the name of phase 'i'.
+   */
+  const std::string& name( size_t i ) const;
+
+  /**
+   * Returns the durations of phase 'i'.
+   */
+  const SeriesTimer& phase( size_t i ) const;
+
+  /**
+   * Returns the total durations of the runs.
+   */
+  const SeriesTimer& total() const;
+
+  /**
+   * Discards all recorded runs.
+   */
+  void reset();
+
+  /**
+   * This method prints out one line of statistics per phase.
+   */
+  void print( const char* msg = "",
+    Stopwatch::timeunit_t timeunit = Stopwatch::MICROSEC,
+    std::ostream& os = std::cout ) const;
+
+private:
+  std::string _names[ N ];
+  SeriesTimer _phases[ N ];
+  SeriesTimer _total;
+  uint64_t _incomplete;
+};
+
+#ifdef ENABLE_TIMING
+template < size_t N >
+inline LapTimer< N >::LapTimer()
+  : _last( 0 )
+  , _laps( 0 )
+{
+}
+
+template < size_t N >
+inline void
+LapTimer< N >::start()
+{
+  _laps = 0;
+  _last = Stopwatch::get_timestamp();
+}
+
+template < size_t N >
+inline void
+LapTimer< N >::lap()
+{
+  assert( _last != 0 ); // start() not called
+  if ( _last == 0 )
+  {
+    return;
+  }
+  Stopwatch::timestamp_t now = Stopwatch::get_timestamp();
+  if ( _laps < N )
+  {
+    _phases[ _laps++ ] = now - _last;
+  }
+  _last = now;
+}
+
+template < size_t N >
+inline size_t
+LapTimer< N >::laps() const
+{
+  return _laps;
+}
+
+template < size_t N >
+inline Stopwatch::timestamp_t
+LapTimer< N >::phase_timestamp( size_t i ) const
+{
+  assert( i < _laps );
+  return _phases[ i ];
+}
+
+template < size_t N >
+inline double
+LapTimer< N >::phase( size_t i, Stopwatch::timeunit_t timeunit ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  return 1.0 * phase_timestamp( i ) / timeunit;
+}
+
+template < size_t N >
+inline double
+LapTimer< N >::total( Stopwatch::timeunit_t timeunit ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  Stopwatch::timestamp_t sum = 0;
+  for ( size_t i = 0; i < _laps; ++i )
+  {
+    sum += _phases[ i ];
+  }
+  return 1.0 * sum / timeunit;
+}
+
+template < size_t N >
+inline void
+LapTimer< N >::reset()
+{
+  _laps = 0;
+}
+#else
+template < size_t N >
+inline LapTimer< N >::LapTimer()
+{
+}
+
+template < size_t N >
+inline void
+LapTimer< N >::start()
+{
+}
+
+template < size_t N >
+inline void
+LapTimer< N >::lap()
+{
+}
+
+template < size_t N >
+inline size_t
+LapTimer< N >::laps() const
+{
+  return 0;
+}
+
+template < size_t N >
+inline Stopwatch::timestamp_t
+LapTimer< N >::phase_timestamp( size_t ) const
+{
+  return 0;
+}
+
+template < size_t N >
+inline double
+LapTimer< N >::phase( size_t, Stopwatch::timeunit_t ) const
+{
+  return 0.0;
+}
+
+template < size_t N >
+inline double
+LapTimer< N >::total( Stopwatch::timeunit_t ) const
+{
+  return 0.0;
+}
+
+template < size_t N >
+inline void
+LapTimer< N >::reset()
+{
+}
+#endif
+
+template < size_t N >
+PhaseBreakdown< N >::PhaseBreakdown( const char* const* names, SeriesTimer::storage_t storage )
+  : _total( storage )
+  , _incomplete( 0 )
+{
+  for ( size_t i = 0; i < N; ++i )
+  {
+    _names[ i ] = names[ i ];
+    _phases[ i ] = SeriesTimer( storage );
+  }
+}
+
+template < size_t N >
+inline void
+PhaseBreakdown< N >::add( const LapTimer< N >& laps )
+{
+  if ( laps.laps() < N )
+  {
+    ++_incomplete;
+    return;
+  }
+  Stopwatch::timestamp_t sum = 0;
+  for ( size_t i = 0; i < N; ++i )
+  {
+    _phases[ i ].record( laps.phase_timestamp( i ) );
+    sum += laps.phase_timestamp( i );
+  }
+  _total.record( sum );
+}
+
+template < size_t N >
+inline uint64_t
+PhaseBreakdown< N >::incomplete() const
+{
+  return _incomplete;
+}
+
+template < size_t N >
+inline const std::string&
+PhaseBreakdown< N >::name( size_t i ) const
+{
+  assert( i < N );
+  return _names[ i ];
+}
+
+template < size_t N >
+inline const SeriesTimer&
+PhaseBreakdown< N >::phase( size_t i ) const
+{
+  assert( i < N );
+  return _phases[ i ];
+}
+
+template < size_t N >
+inline const SeriesTimer&
+PhaseBreakdown< N >::total() const
+{
+  return _total;
+}
+
+template < size_t N >
+void
+PhaseBreakdown< N >::reset()
+{
+  for ( size_t i = 0; i < N; ++i )
+  {
+    _phases[ i ].reset();
+  }
+  _total.reset();
+  _incomplete = 0;
+}
+
+template < size_t N >
+void
+PhaseBreakdown< N >::print( const char* msg, Stopwatch::timeunit_t timeunit, std::ostream& os ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+
+  const char* unit = "";
+  switch ( timeunit )
+  {
+    case Stopwatch::MICROSEC:
+      unit = "microsec";
+      break;
+    case Stopwatch::MILLISEC:
+      unit = "millisec";
+      break;
+    case Stopwatch::SECONDS:
+      unit = "sec";
+      break;
+    case Stopwatch::MINUTES:
+      unit = "min";
+      break;
+    case Stopwatch::HOURS:
+      unit = "h";
+      break;
+    case Stopwatch::DAYS:
+      unit = "days";
+      break;
+  }
+  os << msg << " (" << unit << "), " << _total.size() << " runs";
+  if ( _incomplete > 0 )
+  {
+    os << " (" << _incomplete << " incomplete skipped)";
+  }
+  os << ":" << std::endl;
+  double total = _total.sum( timeunit );
+  for ( size_t i = 0; i < N; ++i )
+  {
+    const SeriesTimer& phase = _phases[ i ];
+    os << std::setw( 20 ) << _names[ i ].c_str() << " :: ";
+    if ( phase.size() == 0 )
+    {
+      os << "no timings" << std::endl;
+      continue;
+    }
+    os << "mean " << phase.mean( timeunit ) << " p50 " << phase.quantile( 0.5, timeunit )
+       << " p99 " << phase.quantile( 0.99, timeunit ) << " max " << phase.quantile( 1.0, timeunit )
+       << " (" << ( total > 0.0 ? 100.0 * phase.sum( timeunit ) / total : 0.0 ) << "%)"
+       << std::endl;
+  }
+  if ( _total.size() > 0 )
+  {
+    os << std::setw( 20 ) << "total"
+       << " :: mean " << _total.mean( timeunit ) << " p50 " << _total.quantile( 0.5, timeunit )
+       << " p99 " << _total.quantile( 0.99, timeunit ) << " max "
+       << _total.quantile( 1.0, timeunit ) << std::endl;
+  }
+}
+
+} /* namespace timer */
+#endif /* LAP_TIMER_H */
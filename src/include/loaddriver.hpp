@@ -0,0 +1,233 @@
+/**
+ * loaddriver.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef LOAD_DRIVER_H
+#define LOAD_DRIVER_H
+
+#include <algorithm>
+#include <iostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "seriestimer.hpp"
+#include "stopwatch.hpp"
+#include "timer_config.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace timer
+{
+
+/**
+ * Settings of the load driver.
+ */
+struct SLoadOptions
+{
+  double duration; // of each rate step in sec.
+  int threads;     // workers; 0: omp_get_max_threads()
+  double spin;     // busy-wait this many microsec. before a start, instead of sleeping
+
+  SLoadOptions();
+};
+
+/************************************************************************
+ * LoadResult                                                           *
+ *   Result of one rate step of load(): the latencies are measured      *
+ *   from the intended start of each request, not from its actual       *
+ *   start, hence stalls of the system under test are not hidden        *
+ *   (coordinated omission).                                            *
+ ************************************************************************/
+class LoadResult
+{
+public:
+  LoadResult( const std::string& name,
+    double rate,
+    double elapsed,
+    uint64_t late,
+    const SeriesTimer& latencies );
+
+  /**
+   * Returns the name of the load.
+   */
+  const std::string& name() const;
+
+  /**
+   * Returns the target rate in requests per second.
+   */
+  double rate() const;
+
+  /**
+   * Returns the achieved rate in completed requests per second.
+   */
+  double throughput() const;
+
+  /**
+   * Returns the number of requests, that started more than one
+   * interval (1 / rate) after their intended start, i.e. all workers
+   * were busy.
+   */
+  uint64_t late() const;
+
+  /**
+   * Returns the latencies of all requests in microseconds.
+   */
+  const SeriesTimer& latencies() const;
+
+  /**
+   * This method prints out a one line summary.
+   */
+  void print( const char* msg = "",
+    Stopwatch::timeunit_t timeunit = Stopwatch::MICROSEC,
+    std::ostream& os = std::cout ) const;
+
+  /**
+   * Convenient method for writing the summary in microseconds
+   * to some ostream.
+   */
+  friend std::ostream& operator<<( std::ostream& os, const LoadResult& result );
+
+private:
+  std::string _name;
+  double _rate;
+  double _elapsed; // from the first intended start to the end of the step in sec.
+  uint64_t _late;
+  SeriesTimer _latencies;
+};
+
+namespace detail
+{
+/**
+ * Returns a monotonic timestamp in nanoseconds.
+ */
+uint64_t monotonic_ns();
+
+/**
+ * Waits until monotonic_ns() reaches 'deadline': sleeps until 'spin'
+ * nanoseconds before it (clock_nanosleep with an absolute time, hence
+ * no drift), then busy-waits. Returns immediately, if late.
+ */
+void wait_until( uint64_t deadline, uint64_t spin );
+}
+
+/************************************************************************
+ * load                                                                 *
+ *   Drives 'function' open-loop at each of the target 'rates'          *
+ *   (requests per second) for 'duration' seconds each: request i of a  *
+ *   step is due at begin + i / rate, independent of how long earlier   *
+ *   requests took. A free worker takes the next request from a shared  *
+ *   counter, hence one slow request does not hold up later ones while  *
+ *   other workers are idle. It waits for the due time with a sleep     *
+ *   and a final busy-wait, and records the time from the due time to   *
+ *   the completion in its own SeriesTimer; these are merged after the  *
+ *   step. Hence a stall shows up in the latencies of all requests due  *
+ *   meanwhile. Steps with a rate <= 0 are skipped.                     *
+ *                                                                      *
+ *   Usage example:                                                     *
+ *     std::vector< double > rates;                                     *
+ *     rates.push_back( 1000 );                                         *
+ *     rates.push_back( 2000 );                                         *
+ *     std::vector< LoadResult > r = load( "query", [] {                *
+ *       do_not_optimize( query() );                                    *
+ *     }, rates );                                                      *
+ *     for ( size_t i = 0; i < r.size(); ++i ) r[ i ].print();          *
+ *     // query @ 1000/s: 999.8/s, 0 late, latency p50 41 p90 55        *
+ *     //   p99 180 p99.9 920 max 1710 microsec. (5000 requests)        *
+ ************************************************************************/
+template < class Function >
+std::vector< LoadResult >
+load( const std::string& name,
+  Function function,
+  const std::vector< double >& rates,
+  const SLoadOptions& options = SLoadOptions() )
+{
+#ifdef _OPENMP
+  int threads = options.threads > 0 ? options.threads : omp_get_max_threads();
+#endif
+  uint64_t spin = ( uint64_t )( options.spin * 1000.0 );
+  std::vector< LoadResult > results;
+  for ( size_t r = 0; r < rates.size(); ++r )
+  {
+    if ( not( rates[ r ] > 0.0 ) )
+    {
+      continue; // no interval between due times
+    }
+    uint64_t requests = ( uint64_t )( rates[ r ] * options.duration );
+    double interval = 1e9 / rates[ r ]; // between due times in nanosec.
+    SeriesTimer latencies;
+    uint64_t late = 0;
+    uint64_t end = 0;
+    uint64_t next = 0; // request to take
+    // a little ahead, such that all workers wait for the first request
+    uint64_t begin = detail::monotonic_ns() + 1000000;
+#ifdef _OPENMP
+#pragma omp parallel num_threads( threads ) reduction( + : late )
+#endif
+    {
+      SeriesTimer local;
+      uint64_t last = 0;
+      for ( ;; )
+      {
+        uint64_t i;
+#ifdef _OPENMP
+#pragma omp atomic capture
+#endif
+        i = next++;
+        if ( i >= requests )
+        {
+          break;
+        }
+        uint64_t due = begin + ( uint64_t )( i * interval );
+        detail::wait_until( due, spin );
+        if ( detail::monotonic_ns() > due + interval )
+        {
+          ++late;
+        }
+        function();
+        last = detail::monotonic_ns();
+        local.record( ( last - due + 500 ) / 1000 );
+      }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+      {
+        latencies.merge( local );
+        end = std::max( end, last );
+      }
+    }
+    // at least the scheduled duration, such that keeping up yields the rate
+    end = std::max( end, begin + ( uint64_t )( requests * interval ) );
+    double elapsed = ( end - begin ) / 1e9;
+    results.push_back( LoadResult( name, rates[ r ], elapsed, late, latencies ) );
+  }
+  return results;
+}
+
+} /* namespace timer */
+#endif /* LOAD_DRIVER_H */
@@ -0,0 +1,179 @@
+/**
+ * mappedseries.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MAPPED_SERIES_H
+#define MAPPED_SERIES_H
+
+#include <iostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "seriestimer.hpp"
+#include "stopwatch.hpp"
+#include "timer_config.hpp"
+
+namespace timer
+{
+
+/************************************************************************
+ * MappedSeries                                                         *
+ *   Read-only view of a file written by SeriesTimer::save(). The file  *
+ *   is mapped into memory (mmap), hence opening does not read the      *
+ *   timings: with the RAW encoding, the statistics run directly on     *
+ *   the mapping; with PACKED, one block at a time is decoded. Files    *
+ *   of the previous version (always PACKED) are supported as well.     *
+ *                                                                      *
+ *   concat() writes several files as one without decoding: the block   *
+ *   records of PACKED files are copied as they are.                    *
+ *                                                                      *
+ *   Usage example:                                                     *
+ *     SeriesTimer x;                                                   *
+ *     // ... record                                                    *
+ *     x.save( "nightly.bin", SeriesTimer::RAW );                       *
+ *     MappedSeries m( "nightly.bin" );                                 *
+ *     cout << "Avg: " << m.mean() << " sec." << endl;                  *
+ *     SeriesTimer y = m.series(); // for other statistics              *
+ ************************************************************************/
+class MappedSeries
+{
+public:
+  /**
+   * Creates a view, that is not open.
+   */
+  MappedSeries();
+
+  /**
+   * Opens the file 'path'; check with isOpen().
+   */
+  explicit MappedSeries( const std::string& path );
+
+  /**
+   * Closes the view.
+   */
+  ~MappedSeries();
+
+  /**
+   * Maps the file 'path'. Returns false, if it does not contain a
+   * valid series.
+   */
+  bool open( const std::string& path );
+
+  /**
+   * Unmaps the file.
+   */
+  void close();
+
+  /**
+   * Returns, whether a file is open.
+   */
+  bool isOpen() const;
+
+  /**
+   * Returns the encoding of the file.
+   */
+  SeriesTimer::storage_t encoding() const;
+
+  /**
+   * Returns the number of timings.
+   */
+  size_t size() const;
+
+  /**
+   * Returns the total elapsed time of the series.
+   */
+  double sum( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the average time of the series.
+   */
+  double mean( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the standard deviation time of the series.
+   */
+  double std( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the q-th quantile timing of the series.
+   */
+  double quantile( double q = 0.5, Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the timings as SeriesTimer with 'storage'. PACKED blocks
+   * are copied into a PACKED SeriesTimer without decoding.
+   */
+  SeriesTimer series( SeriesTimer::storage_t storage = SeriesTimer::RAW ) const;
+
+  /**
+   * Writes the series of the files 'inputs' one after the other into
+   * the file 'output', without decoding: PACKED, unless all inputs are
+   * RAW. Returns false, if an input is not valid or writing fails.
+   * The file is written as output + ".tmp" and renamed at the end,
+   * hence 'output' may be one of the inputs, and is left unchanged on
+   * failure.
+   */
+  static bool concat( const std::vector< std::string >& inputs, const std::string& output );
+
+private:
+  MappedSeries( const MappedSeries& );   // Don't Implement
+  void operator=( const MappedSeries& ); // Don't implement
+
+  /**
+   * Returns the number of chunks, the timings are stored in.
+   */
+  size_t chunks() const;
+
+  /**
+   * Sets 'data' to the timings of chunk 'c' and returns their number.
+   * Packed chunks are decoded into 'buf'.
+   */
+  size_t chunk( size_t c,
+    std::vector< Stopwatch::timestamp_t >& buf,
+    const Stopwatch::timestamp_t*& data ) const;
+
+  /**
+   * Returns the number of block records write_records() writes.
+   */
+  size_t records() const;
+
+  /**
+   * Writes the timings as block records of PackedSamples to 'os'.
+   */
+  void write_records( std::ostream& os ) const;
+
+  char* _data;    // mapping (or copy) of the whole file
+  size_t _length; // of _data in bytes
+  bool _mapped;   // false: _data is a heap copy
+  SeriesTimer::storage_t _encoding;
+  uint64_t _count;
+  const uint64_t* _payload;      // the timings or the first block record
+  std::vector< size_t > _blocks; // word offsets of the block records in _payload
+};
+
+} /* namespace timer */
+#endif /* MAPPED_SERIES_H */
@@ -0,0 +1,155 @@
+/**
+ * measure.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MEASURE_H
+#define MEASURE_H
+
+#include "stopwatch.hpp"
+#include "timer_config.hpp"
+
+#if __cplusplus >= 201103L
+#define TIMER_NOEXCEPT noexcept
+#else
+#define TIMER_NOEXCEPT
+#endif
+
+namespace timer
+{
+
+/************************************************************************
+ * ScopedMeasure                                                        *
+ *   Records exactly one timing: from its creation until its            *
+ *   destruction, also if the scope is left by return or exception.     *
+ *   The begin is kept in the guard, hence the running state of the     *
+ *   recorder is neither checked nor changed: a measurement costs two   *
+ *   clock reads and the 'record' of the elapsed time.                  *
+ *                                                                      *
+ *   Any class with 'void record( Stopwatch::timestamp_t )' can be      *
+ *   used as Recorder, e.g. Stopwatch, SeriesTimer and                  *
+ *   ConcurrentSeriesTimer.                                             *
+ *                                                                      *
+ *   Usage example:                                                     *
+ *     SeriesTimer x;                                                   *
+ *     for (int32_t i = 0; i < 10; ++i)                                 *
+ *     {                                                                *
+ *         ScopedMeasure< SeriesTimer > g( x ); // or: x.scoped()       *
+ *         // do computation ...                                        *
+ *     } // timing is recorded here                                     *
+ *     measure( x, some_function ); // records the call                 *
+ ************************************************************************/
+template < class Recorder >
+class ScopedMeasure
+{
+public:
+  /**
+   * Begins the measurement for 'recorder'.
+   */
+  explicit ScopedMeasure( Recorder& recorder ) TIMER_NOEXCEPT;
+
+  /**
+   * Takes over the measurement of 'other', which will not record anything.
+   * Allows returning guards by value, e.g. from SeriesTimer::scoped().
+   */
+  ScopedMeasure( const ScopedMeasure& other ) TIMER_NOEXCEPT;
+
+  /**
+   * Records the time elapsed since creation.
+   */
+  ~ScopedMeasure();
+
+private:
+#ifdef ENABLE_TIMING
+  mutable Recorder* _recorder;
+  Stopwatch::timestamp_t _begin;
+#endif
+
+  void operator=( ScopedMeasure const& ); // Don't implement
+};
+
+/**
+ * Returns a guard, that records the time until the end of the scope to 'recorder'.
+ */
+template < class Recorder >
+inline ScopedMeasure< Recorder >
+scoped( Recorder& recorder ) TIMER_NOEXCEPT
+{
+  return ScopedMeasure< Recorder >( recorder );
+}
+
+/**
+ * Calls 'function' and records the duration of the call to 'recorder'.
+ */
+template < class Recorder, class Function >
+inline void
+measure( Recorder& recorder, Function function )
+{
+  ScopedMeasure< Recorder > guard( recorder );
+  function();
+}
+
+#ifdef ENABLE_TIMING
+template < class Recorder >
+inline ScopedMeasure< Recorder >::ScopedMeasure( Recorder& recorder ) TIMER_NOEXCEPT
+  : _recorder( &recorder )
+  , _begin( Stopwatch::get_timestamp() )
+{
+}
+
+template < class Recorder >
+inline ScopedMeasure< Recorder >::ScopedMeasure( const ScopedMeasure& other ) TIMER_NOEXCEPT
+  : _recorder( other._recorder )
+  , _begin( other._begin )
+{
+  other._recorder = 0;
+}
+
+template < class Recorder >
+inline ScopedMeasure< Recorder >::~ScopedMeasure()
+{
+  if ( _recorder )
+  {
+    _recorder->record( Stopwatch::get_timestamp() - _begin );
+  }
+}
+#else
+template < class Recorder >
+inline ScopedMeasure< Recorder >::ScopedMeasure( Recorder& ) TIMER_NOEXCEPT
+{
+}
+
+template < class Recorder >
+inline ScopedMeasure< Recorder >::ScopedMeasure( const ScopedMeasure& ) TIMER_NOEXCEPT
+{
+}
+
+template < class Recorder >
+inline ScopedMeasure< Recorder >::~ScopedMeasure()
+{
+}
+#endif
+
+} /* namespace timer */
+#endif /* MEASURE_H */
@@ -0,0 +1,64 @@
+/**
+ * metricsserver.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include "timer_config.hpp"
+
+namespace timer
+{
+
+/************************************************************************
+ * Metrics server                                                       *
+ *   A minimal HTTP endpoint on localhost, that answers                 *
+ *   'GET /metrics' with render_openmetrics(), e.g. for scraping by     *
+ *   Prometheus. One request at a time is served on its own thread,     *
+ *   with a reused buffer; the server is stopped at program exit. It    *
+ *   does not run in children of fork().                                *
+ *                                                                      *
+ *   Usage example:                                                     *
+ *     start_metrics_server( 9464 );                                    *
+ *     // curl http://127.0.0.1:9464/metrics                            *
+ *     // # TYPE timer_scope_calls counter                              *
+ *     // timer_scope_calls_total{scope="fib",thread="0"} 1             *
+ *     // ...                                                           *
+ ************************************************************************/
+
+/**
+ * Starts serving the metrics on 127.0.0.1:'port'. Returns false, if
+ * the server already runs, the port is not available, or sockets and
+ * threads are not supported.
+ */
+bool start_metrics_server( int port = 9464 );
+
+/**
+ * Stops the metrics server, if running.
+ */
+void stop_metrics_server();
+
+} /* namespace timer */
+#endif /* METRICS_SERVER_H */
@@ -0,0 +1,193 @@
+/**
+ * packedsamples.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PACKED_SAMPLES_H
+#define PACKED_SAMPLES_H
+
+#include <iostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "stopwatch.hpp"
+#include "timer_config.hpp"
+
+namespace timer
+{
+
+/************************************************************************
+ * PackedSamples                                                        *
+ *   Compact storage for a series of timestamps. Samples are grouped    *
+ *   in blocks of BLOCK_SIZE values; each block is stored relative to   *
+ *   its minimum (frame of reference) and bit-packed with the width     *
+ *   of its largest offset. Durations of a few milliseconds need        *
+ *   about 10 - 24 bits instead of 64.                                  *
+ *                                                                      *
+ *   A block is a self-contained record of 64 bit words:                *
+ *     [ base | count + ( width << 32 ) | packed words ... ]            *
+ *   The in-memory records are written to disk as they are, hence       *
+ *   files can be concatenated block-wise without decoding.             *
+ *                                                                      *
+ *   The last, not yet full block is kept unpacked until it fills up.   *
+ *   Incomplete records may also occur in the middle, e.g. after        *
+ *   reading concatenated files.                                        *
+ *                                                                      *
+ *   Usage example:                                                     *
+ *     PackedSamples p;                                                 *
+ *     p.push_back( 1234 );                                             *
+ *     std::vector< PackedSamples::value_t > buf( p.BLOCK_SIZE );       *
+ *     for (size_t b = 0; b < p.blocks(); ++b)                          *
+ *     {                                                                *
+ *       size_t n = p.decode( b, &buf[ 0 ] );                           *
+ *       // ... use buf[ 0 ] .. buf[ n - 1 ]                            *
+ *     }                                                                *
+ ************************************************************************/
+class PackedSamples
+{
+public:
+  typedef Stopwatch::timestamp_t value_t;
+
+  enum
+  {
+    BLOCK_SIZE = 128,
+    HEADER_WORDS = 2
+  };
+
+  /**
+   * Creates an empty sample store.
+   */
+  PackedSamples();
+
+  /**
+   * Appends a sample.
+   */
+  void push_back( value_t value );
+
+  /**
+   * Appends the samples of the block record at 'record'. A complete
+   * block is copied without decoding; an incomplete one goes to the
+   * unpacked last block. Returns the number of words of the record.
+   */
+  size_t append_block( const uint64_t* record );
+
+  /**
+   * Appends all samples of 'other'; its complete blocks are copied
+   * without decoding.
+   */
+  void append( const PackedSamples& other );
+
+  /**
+   * Returns the number of stored samples.
+   */
+  size_t size() const;
+
+  /**
+   * Returns, whether no samples are stored.
+   */
+  bool empty() const;
+
+  /**
+   * Removes all samples.
+   */
+  void clear();
+
+  /**
+   * Returns the number of blocks, including the unpacked last block.
+   */
+  size_t blocks() const;
+
+  /**
+   * Decodes block 'block' into 'out', which has to hold at least
+   * BLOCK_SIZE values. Returns the number of decoded samples.
+   */
+  size_t decode( size_t block, value_t* out ) const;
+
+  /**
+   * Returns the number of bytes used for the samples.
+   */
+  size_t bytes() const;
+
+  /**
+   * Writes the samples in their packed encoding to 'os':
+   * the number of blocks followed by the block records.
+   */
+  void write( std::ostream& os ) const;
+
+  /**
+   * Replaces the samples with the ones read from 'is'. Returns false,
+   * if the stream does not contain valid packed samples.
+   */
+  bool read( std::istream& is );
+
+  /**
+   * Appends the block record for 'count' (at most BLOCK_SIZE) values
+   * to 'out'. Returns the number of appended words.
+   */
+  static size_t encode_block( const value_t* in, size_t count, std::vector< uint64_t >& out );
+
+  /**
+   * Decodes the block record starting at 'record' into 'out'.
+   * Returns the number of decoded samples.
+   */
+  static size_t decode_block( const uint64_t* record, value_t* out );
+
+  /**
+   * Returns the number of words of the block record starting at 'record'.
+   */
+  static size_t block_words( const uint64_t* record );
+
+private:
+  /**
+   * Packs the unpacked last block, even if it is incomplete.
+   */
+  void pack_tail();
+
+  std::vector< uint64_t > _words;
+  std::vector< size_t > _offsets;
+  std::vector< value_t > _tail;
+  size_t _size;
+};
+
+inline size_t
+PackedSamples::size() const
+{
+  return _size;
+}
+
+inline bool
+PackedSamples::empty() const
+{
+  return _size == 0;
+}
+
+inline size_t
+PackedSamples::blocks() const
+{
+  return _offsets.size() + ( _tail.empty() ? 0 : 1 );
+}
+
+} /* namespace timer */
+#endif /* PACKED_SAMPLES_H */
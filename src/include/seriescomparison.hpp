@@ -0,0 +1,140 @@
+/**
+ * seriescomparison.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SERIES_COMPARISON_H
+#define SERIES_COMPARISON_H
+
+#include <iostream>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "seriestimer.hpp"
+#include "stopwatch.hpp"
+#include "timer_config.hpp"
+
+namespace timer
+{
+
+/************************************************************************
+ * SeriesComparison                                                     *
+ *   Compares the timings of a candidate SeriesTimer against a          *
+ *   baseline, e.g. for A/B performance checks in CI:                   *
+ *     - Mann-Whitney U test (normal approximation with tie             *
+ *       correction) for a shift between the two distributions,        *
+ *     - bootstrap confidence intervals of the shift of the median      *
+ *       and of the 99% quantile (resampled in parallel with OpenMP,    *
+ *       each resampled quantile in O(1) from the sorted timings).      *
+ *   The verdict is SLOWER or FASTER, if the U test is significant at   *
+ *   level 'alpha', and NOT_SIGNIFICANT otherwise.                      *
+ *                                                                      *
+ *   Usage example:                                                     *
+ *     SeriesTimer baseline, candidate;                                 *
+ *     // ... record both                                               *
+ *     SeriesComparison c( baseline, candidate );                       *
+ *     c.print( "", Stopwatch::MICROSEC );                              *
+ *     //  Comparison (microsec): baseline n = 1000, candidate n = 1000 *
+ *     //    Mann-Whitney U = 612034, p = 1.78e-18                      *
+ *     //      median shift = 12 [10, 14] (95% CI)                      *
+ *     //         p99 shift = 31 [18, 47] (95% CI)                      *
+ *     //           verdict = slower (alpha = 0.05)                     *
+ *     if ( c.verdict() == SeriesComparison::SLOWER ) { ... }           *
+ ************************************************************************/
+class SeriesComparison
+{
+public:
+  enum verdict_t
+  {
+    FASTER,
+    SLOWER,
+    NOT_SIGNIFICANT
+  };
+
+  /**
+   * Shift of a statistic (candidate - baseline) with its confidence interval.
+   */
+  typedef SeriesTimer::SInterval SInterval;
+
+  /**
+   * Compares 'candidate' against 'baseline' at significance level 'alpha',
+   * with 'resamples' bootstrap resamples for the confidence intervals.
+   */
+  SeriesComparison( const SeriesTimer& baseline,
+    const SeriesTimer& candidate,
+    double alpha = 0.05,
+    size_t resamples = 1000 );
+
+  /**
+   * Returns, whether the candidate is significantly faster or slower.
+   */
+  verdict_t verdict() const;
+
+  /**
+   * Returns the Mann-Whitney U statistic of the candidate, i.e. the
+   * number of pairs where the candidate timing is larger (ties count 1/2).
+   */
+  double u() const;
+
+  /**
+   * Returns the two-sided p-value of the Mann-Whitney U test.
+   */
+  double p_value() const;
+
+  /**
+   * Returns the shift of the median with its confidence interval.
+   */
+  SInterval median( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the shift of the 99% quantile with its confidence interval.
+   */
+  SInterval p99( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * This method prints out the test results and the verdict.
+   */
+  void print( const char* msg = "",
+    Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS,
+    std::ostream& os = std::cout ) const;
+
+  /**
+   * Convenient method for writing the comparison in seconds
+   * to some ostream.
+   */
+  friend std::ostream& operator<<( std::ostream& os, const SeriesComparison& comparison );
+
+private:
+  size_t _baseline_size;
+  size_t _candidate_size;
+  double _alpha;
+  double _u;
+  double _p_value;
+  SInterval _median; // in microseconds
+  SInterval _p99;    // in microseconds
+  verdict_t _verdict;
+};
+
+} /* namespace timer */
+#endif /* SERIES_COMPARISON_H */
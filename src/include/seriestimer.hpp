@@ -28,9 +28,13 @@
 #define SERIES_TIMER_H
 
 #include <iostream>
+#include <stddef.h>
 #include <stdint.h>
+#include <string>
 #include <vector>
 
+#include "measure.hpp"
+#include "packedsamples.hpp"
 #include "stopwatch.hpp"
 #include "timer_config.hpp"
 
@@ -42,6 +46,16 @@ namespace timer
  *   The SeriesTimer stores subsequent timings in a vector and is       *
  *   able to perform basic statistical analysis on the time series.     *
  *                                                                      *
+ *   With storage PACKED, the timings are stored block-wise compressed  *
+ *   (see PackedSamples), which needs 3-5x less memory for typical      *
+ *   durations; all statistics are computed over the decoded blocks.    *
+ *                                                                      *
+ *   Besides mean and std, which are skewed by single outliers (e.g.    *
+ *   page faults or preemption), the series has robust statistics:      *
+ *   mad, trimmed and winsorized mean, Tukey outlier counts and         *
+ *   bootstrap confidence intervals of quantiles. Quantiles use         *
+ *   selection (nth_element) instead of sorting the series.             *
+ *                                                                      *
  *   Not thread-safe: - Do not share SeriesTimer among threads.         *
  *                    - Let each thread have its own SeriesTimer.       *
  *                                                                      *
@@ -65,18 +79,57 @@ namespace timer
  *     //    q 50% (median) = 1.00134                                   *
  *     //             q 75% = 1.00134                                   *
  *     //      q 100% (max) = 1.00137                                   *
+ *     //               mad = 0                                         *
+ *     //      trimmed mean = 1.00129                                   *
+ *     //   winsorized mean = 1.00127                                   *
+ *     //     median 95% CI = [1.00133, 1.00134]                        *
+ *     //          outliers = 2 low severe, 0 low mild, 0 high mild,    *
+ *     //                     2 high severe                             *
  *     cout << "Sum: " << x.sum(Stopwatch::SECONDS) << " sec." << endl; *
  *     cout << "Avg: " << x.mean() << " sec." << endl; // default is sec*
  *     cout << "Std: " << x.std() << " sec." << endl;                   *
  *     x.reset(); // clear the timings                                  *
+ *     {                                                                *
+ *         ScopedMeasure< SeriesTimer > g = x.scoped();                 *
+ *         // do computation ...                                        *
+ *     } // timing is added here                                        *
  ************************************************************************/
 class SeriesTimer
 {
 public:
+  enum storage_t
+  {
+    RAW,
+    PACKED
+  };
+
+  /**
+   * Estimate of a statistic with its confidence interval.
+   */
+  struct SInterval
+  {
+    double estimate;
+    double low;
+    double high;
+  };
+
+  /**
+   * Number of outliers outside of the Tukey fences: mild ones are more
+   * than 1.5 IQR, severe ones more than 3 IQR below the first or above
+   * the third quartile.
+   */
+  struct SOutliers
+  {
+    size_t low_severe;
+    size_t low_mild;
+    size_t high_mild;
+    size_t high_severe;
+  };
+
   /**
    * Creates a SeriesTimer that is not running.
    */
-  SeriesTimer();
+  explicit SeriesTimer( storage_t storage = RAW );
 
   /**
    * Beginns a new measurment for this SeriesTimer.
@@ -88,6 +141,23 @@ public:
    */
   void stop();
 
+  /**
+   * Adds a timing, that was measured elsewhere, to the series.
+   */
+  void record( Stopwatch::timestamp_t elapsed );
+
+  /**
+   * Returns a guard, that adds the time until the end of its scope
+   * to the series. Does not use the start/stop state of the SeriesTimer.
+   */
+  ScopedMeasure< SeriesTimer > scoped();
+
+  /**
+   * Appends all timings of 'other' to the series. Between PACKED
+   * series, complete blocks are copied without decoding.
+   */
+  void merge( const SeriesTimer& other );
+
   /**
    * Returns, whether the SeriesTimer is running.
    */
@@ -98,11 +168,21 @@ public:
    */
   void reset();
 
+  /**
+   * Returns the number of timings in the series.
+   */
+  size_t size() const;
+
   /**
    * Returns the individual timings in the requested timeunit.
    */
   std::vector< double > timings( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
 
+  /**
+   * Returns the individual timings as timestamps, i.e. in microseconds.
+   */
+  std::vector< Stopwatch::timestamp_t > timestamps() const;
+
   /**
    * Returns the total elapsed time of the series.
    */
@@ -123,6 +203,42 @@ public:
    */
   double quantile( double q = 0.5, Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
 
+  /**
+   * Returns the median absolute deviation from the median of the series
+   * (unscaled; multiply by 1.4826 to estimate std for normal timings).
+   */
+  double mad( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the average time of the series without the 'fraction'
+   * smallest and the 'fraction' largest timings, 0 <= fraction < 0.5.
+   */
+  double trimmed_mean( double fraction = 0.1,
+    Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the average time of the series, where the 'fraction'
+   * smallest and the 'fraction' largest timings are replaced by the
+   * nearest remaining one, 0 <= fraction < 0.5.
+   */
+  double winsorized_mean( double fraction = 0.1,
+    Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+  /**
+   * Returns the number of mild and severe outliers (Tukey fences).
+   */
+  SOutliers outliers() const;
+
+  /**
+   * Returns the q-th quantile timing with its bootstrap confidence
+   * interval at 'level' from 'resamples' resamples. The result is
+   * reproducible, i.e. the same for the same series.
+   */
+  SInterval confidence_interval( double q = 0.5,
+    double level = 0.95,
+    size_t resamples = 1000,
+    Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
   /**
    * This method prints out the currently elapsed time.
    */
@@ -130,6 +246,33 @@ public:
     Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS,
     std::ostream& os = std::cout ) const;
 
+  /**
+   * Writes the timings to 'os' (opened in binary mode): a versioned
+   * header with clock source, unit, count and 'encoding', followed by
+   * the timings as they are (RAW) or in the encoding of PackedSamples
+   * (PACKED). Files with the RAW encoding can be read by MappedSeries
+   * without any copy.
+   */
+  void save( std::ostream& os, storage_t encoding = PACKED ) const;
+
+  /**
+   * Writes the timings to the file 'path'. Returns false on errors.
+   */
+  bool save( const std::string& path, storage_t encoding = PACKED ) const;
+
+  /**
+   * Replaces the timings with the ones written by save() (also of
+   * the previous version). Returns false, if 'is' does not contain a
+   * valid series.
+   */
+  bool load( std::istream& is );
+
+  /**
+   * Replaces the timings with the ones in the file 'path'. Returns
+   * false, if it does not contain a valid series.
+   */
+  bool load( const std::string& path );
+
   /**
    * Convenient method for writing time in seconds
    * to some ostream.
@@ -137,11 +280,79 @@ public:
   friend std::ostream& operator<<( std::ostream& os, const SeriesTimer& SeriesTimer );
 
 private:
+  friend class MappedSeries; // copies blocks into _packed
+
 #ifdef ENABLE_TIMING
+  storage_t _storage;
   Stopwatch _stopwatch;
   std::vector< Stopwatch::timestamp_t > _timestamps;
+  PackedSamples _packed;
+
+  /**
+   * Returns the number of chunks, the timings are stored in.
+   */
+  size_t chunks() const;
+
+  /**
+   * Sets 'data' to the timings of chunk 'c' and returns their number.
+   * Packed chunks are decoded into 'buf'.
+   */
+  size_t chunk( size_t c,
+    std::vector< Stopwatch::timestamp_t >& buf,
+    const Stopwatch::timestamp_t*& data ) const;
 #endif
 };
 
+inline void
+SeriesTimer::start()
+{
+#ifdef ENABLE_TIMING
+  _stopwatch.start();
+#endif
+}
+
+inline void
+SeriesTimer::stop()
+{
+#ifdef ENABLE_TIMING
+  _stopwatch.stop();
+  record( _stopwatch.elapsed_timestamp() );
+  _stopwatch.reset();
+#endif
+}
+
+inline bool
+SeriesTimer::isRunning() const
+{
+#ifdef ENABLE_TIMING
+  return _stopwatch.isRunning();
+#else
+  return false;
+#endif
+}
+
+inline void
+SeriesTimer::record( Stopwatch::timestamp_t elapsed )
+{
+#ifdef ENABLE_TIMING
+  if ( _storage == PACKED )
+  {
+    _packed.push_back( elapsed );
+  }
+  else
+  {
+    _timestamps.push_back( elapsed );
+  }
+#else
+  ( void ) elapsed;
+#endif
+}
+
+inline ScopedMeasure< SeriesTimer >
+SeriesTimer::scoped()
+{
+  return ScopedMeasure< SeriesTimer >( *this );
+}
+
 } /* namespace timer */
 #endif /* SERIES_TIMER_H */
@@ -0,0 +1,292 @@
+/**
+ * span.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <stdint.h>
+#include <string>
+
+#include "stopwatch.hpp"
+#include "timer_config.hpp"
+
+#if __cplusplus >= 202002L && defined( __has_include )
+#if __has_include( <coroutine> )
+#include <coroutine>
+#include <utility>
+#define TIMER_HAS_COROUTINES 1
+#endif
+#endif
+
+namespace timer
+{
+
+namespace detail
+{
+/**
+ * Adds a finished span to the collector of the ScopeTimer.
+ */
+void add_span( const std::string& name,
+  Stopwatch::timestamp_t total,
+  Stopwatch::timestamp_t active,
+  uint64_t suspensions );
+}
+
+/************************************************************************
+ * Span                                                                 *
+ *   Times a logical operation, that may suspend and continue on        *
+ *   another thread, e.g. a coroutine or a task: the total latency      *
+ *   from creation until finish() (or destruction), the active time     *
+ *   between resume() and suspend(), and the suspended time between     *
+ *   suspend() and resume(). Spans with the same name are accumulated   *
+ *   by name, not by thread, and reported at program exit with the      *
+ *   ScopeTimer.                                                        *
+ *                                                                      *
+ *   suspend() and resume() are a clock read on the span itself,        *
+ *   without locking; the span must only be used by one thread at a     *
+ *   time, which is given, if it is handed over with the operation.     *
+ *   finish() adds the span to the collector.                           *
+ *                                                                      *
+ *   With C++20, span.wrap( awaiter ) suspends the span while the       *
+ *   coroutine waits for 'awaiter', and resumes it afterwards.          *
+ *                                                                      *
+ *   Usage example:                                                     *
+ *     task< void > handle( request r )                                 *
+ *     {                                                                *
+ *       Span s( "handle request" );                                    *
+ *       auto data = co_await s.wrap( read_async( r ) );                *
+ *       // ... compute                                                 *
+ *     } // span is finished here                                       *
+ *   // output at program exit:                                         *
+ *   Collected Spans                                                    *
+ *     handle request (spans  100, suspensions  100) :: total 2.31 sec. *
+ *       active 0.12 sec., suspended 2.19 sec.                          *
+ ************************************************************************/
+class Span
+{
+public:
+  /**
+   * Begins an active span.
+   */
+  explicit Span( const std::string& name );
+
+  /**
+   * Finishes the span, if not done before.
+   */
+  ~Span();
+
+  /**
+   * Stops the active time and begins the suspended time.
+   */
+  void suspend();
+
+  /**
+   * Stops the suspended time and begins the active time.
+   */
+  void resume();
+
+  /**
+   * Ends the span and adds it to the collector; a suspended span
+   * counts as resumed at this point.
+   */
+  void finish();
+
+  /**
+   * Returns, whether the span is suspended.
+   */
+  bool isSuspended() const;
+
+  /**
+   * Returns the elapsed total, active and suspended times.
+   */
+  double total( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+  double active( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+  double suspended( Stopwatch::timeunit_t timeunit = Stopwatch::SECONDS ) const;
+
+#ifdef TIMER_HAS_COROUTINES
+  template < class Awaitable >
+  class SpanAwaiter;
+
+  /**
+   * Returns an awaiter, that suspends the span while 'awaitable'
+   * suspends the coroutine. 'awaitable' is an awaiter or has an
+   * operator co_await (member or free), like most task types.
+   */
+  template < class Awaitable >
+  SpanAwaiter< Awaitable > wrap( Awaitable&& awaitable );
+#endif
+
+private:
+  Span( const Span& );           // Don't Implement
+  void operator=( const Span& ); // Don't implement
+
+#if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER )
+  std::string _name;
+  Stopwatch::timestamp_t _begin;
+  Stopwatch::timestamp_t _last;   // last suspend or resume
+  Stopwatch::timestamp_t _active; // before _last
+  Stopwatch::timestamp_t _end;    // 0, if not finished
+  uint64_t _suspensions;
+  bool _suspended;
+#endif
+};
+
+#if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER )
+inline void
+Span::suspend()
+{
+  if ( not _suspended && _end == 0 )
+  {
+    Stopwatch::timestamp_t now = Stopwatch::get_timestamp();
+    _active += now - _last;
+    _last = now;
+    _suspended = true;
+    ++_suspensions;
+  }
+}
+
+inline void
+Span::resume()
+{
+  if ( _suspended && _end == 0 )
+  {
+    _last = Stopwatch::get_timestamp();
+    _suspended = false;
+  }
+}
+
+inline bool
+Span::isSuspended() const
+{
+  return _suspended;
+}
+#else
+inline void
+Span::suspend()
+{
+}
+
+inline void
+Span::resume()
+{
+}
+
+inline bool
+Span::isSuspended() const
+{
+  return false;
+}
+#endif
+
+#ifdef TIMER_HAS_COROUTINES
+namespace detail
+{
+/**
+ * Returns the awaiter of 'awaitable' like co_await does: the result
+ * of its operator co_await (member or free), or 'awaitable' itself.
+ */
+template < class Awaitable >
+auto
+get_awaiter( Awaitable&& awaitable, int )
+  -> decltype( std::forward< Awaitable >( awaitable ).operator co_await() )
+{
+  return std::forward< Awaitable >( awaitable ).operator co_await();
+}
+
+template < class Awaitable >
+auto
+get_awaiter( Awaitable&& awaitable, long )
+  -> decltype( operator co_await( std::forward< Awaitable >( awaitable ) ) )
+{
+  return operator co_await( std::forward< Awaitable >( awaitable ) );
+}
+
+template < class Awaitable >
+Awaitable&&
+get_awaiter( Awaitable&& awaitable, ... )
+{
+  return std::forward< Awaitable >( awaitable );
+}
+}
+
+/**
+ * Forwards to the awaiter of 'Awaitable' and suspends the span in
+ * between. Not copyable, as the awaiter may refer to the awaitable.
+ */
+template < class Awaitable >
+class Span::SpanAwaiter
+{
+public:
+  SpanAwaiter( Span& span, Awaitable&& awaitable )
+    : _span( span )
+    , _awaitable( std::forward< Awaitable >( awaitable ) )
+    , _awaiter( detail::get_awaiter( std::forward< Awaitable >( _awaitable ), 0 ) )
+  {
+  }
+
+  SpanAwaiter( const SpanAwaiter& ) = delete;
+  SpanAwaiter& operator=( const SpanAwaiter& ) = delete;
+
+  bool
+  await_ready()
+  {
+    return _awaiter.await_ready();
+  }
+
+  template < class Promise >
+  decltype( auto )
+  await_suspend( std::coroutine_handle< Promise > handle )
+  {
+    // before handing over, the coroutine may be resumed on another thread
+    _span.suspend();
+    return _awaiter.await_suspend( handle );
+  }
+
+  decltype( auto )
+  await_resume()
+  {
+    _span.resume();
+    return _awaiter.await_resume();
+  }
+
+private:
+  typedef decltype( detail::get_awaiter( std::declval< Awaitable >(), 0 ) ) awaiter_t;
+
+  Span& _span;
+  Awaitable _awaitable; // a reference for lvalues
+  awaiter_t _awaiter;   // a reference, if the awaitable is the awaiter
+};
+
+template < class Awaitable >
+inline Span::SpanAwaiter< Awaitable >
+Span::wrap( Awaitable&& awaitable )
+{
+  return SpanAwaiter< Awaitable >( *this, std::forward< Awaitable >( awaitable ) );
+}
+#endif
+
+} /* namespace timer */
+#endif /* SPAN_H */
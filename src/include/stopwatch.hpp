@@ -31,6 +31,7 @@
 
 #include <iostream>
 #include <stdint.h>
+#include <sys/time.h>
 
 namespace timer
 {
@@ -64,6 +65,9 @@ namespace timer
  *     x.print("Time needed ", Stopwatch::MINUTES, std::cerr);         *
  *     // > Time needed 1,8593 min. (on cerr)                          *
  *     // other units and output streams possible                      *
+ *                                                                     *
+ *   The measuring members are defined inline, such that the clock     *
+ *   reads are not hidden behind library calls.                        *
  ***********************************************************************/
 class Stopwatch
 {
@@ -83,6 +87,18 @@ public:
 
   static bool correct_timeunit( timeunit_t t );
 
+  /**
+   * Returns the calibrated cost of one measurement, i.e. of an empty
+   * start/stop pair, in microseconds. It is the median over many
+   * batches of measurements, computed at the first call.
+   */
+  static double overhead();
+
+  /**
+   * Returns the smallest observed step of the clock in microseconds.
+   */
+  static double resolution();
+
   /**
    * Creates a stopwatch that is not running.
    */
@@ -125,6 +141,12 @@ public:
    */
   timestamp_t elapsed_timestamp() const;
 
+  /**
+   * Adds 'elapsed' microseconds, that were measured elsewhere
+   * (e.g. by a ScopedMeasure), to the elapsed time.
+   */
+  void record( timestamp_t elapsed );
+
   /**
    * Resets the stopwatch.
    */
@@ -142,17 +164,17 @@ public:
    */
   friend std::ostream& operator<<( std::ostream& os, const Stopwatch& stopwatch );
 
+  /**
+   * Returns current time in microseconds since EPOCH.
+   */
+  static timestamp_t get_timestamp();
+
 private:
 #ifdef ENABLE_TIMING
   timestamp_t _beg, _end;
   uint64_t _prev_elapsed;
   bool _running;
 #endif
-
-  /**
-   * Returns current time in microseconds since EPOCH.
-   */
-  static timestamp_t get_timestamp();
 };
 
 inline bool
@@ -161,5 +183,94 @@ Stopwatch::correct_timeunit( timeunit_t t )
   return t == MICROSEC || t == MILLISEC || t == SECONDS || t == MINUTES || t == HOURS || t == DAYS;
 }
 
+inline Stopwatch::timestamp_t
+Stopwatch::get_timestamp()
+{
+  struct timeval now;
+  gettimeofday( &now, ( struct timezone* ) 0 );
+  return ( Stopwatch::timestamp_t ) now.tv_usec
+    + ( Stopwatch::timestamp_t ) now.tv_sec * Stopwatch::SECONDS;
+}
+
+inline Stopwatch::Stopwatch()
+{
+  reset();
+}
+
+inline void
+Stopwatch::start()
+{
+#ifdef ENABLE_TIMING
+  if ( not isRunning() )
+  {
+    _prev_elapsed += _end - _beg;  // store prev. time, if we resume
+    _end = _beg = get_timestamp(); // invariant: _end >= _beg
+    _running = true;               // we start running
+  }
+#endif
+}
+
+inline void
+Stopwatch::stop()
+{
+#ifdef ENABLE_TIMING
+  if ( isRunning() )
+  {
+    _end = get_timestamp(); // invariant: _end >= _beg
+    _running = false;       // we stopped running
+  }
+#endif
+}
+
+inline bool
+Stopwatch::isRunning() const
+{
+#ifdef ENABLE_TIMING
+  return _running;
+#else
+  return false;
+#endif
+}
+
+inline Stopwatch::timestamp_t
+Stopwatch::elapsed_timestamp() const
+{
+#ifdef ENABLE_TIMING
+  if ( isRunning() )
+  {
+    // get intermediate elapsed time; do not change _end, to be const
+    return get_timestamp() - _beg + _prev_elapsed;
+  }
+  else
+  {
+    // stopped before, get time of current measurment + last measurments
+    return _end - _beg + _prev_elapsed;
+  }
+#else
+  return ( timestamp_t ) 0;
+#endif
+}
+
+inline void
+Stopwatch::record( timestamp_t elapsed )
+{
+#ifdef ENABLE_TIMING
+  _prev_elapsed += elapsed;
+#else
+  ( void ) elapsed;
+#endif
+}
+
+inline void
+Stopwatch::reset()
+{
+#ifdef ENABLE_TIMING
+  _beg = 0; // invariant: _end >= _beg
+  _end = 0;
+  _prev_elapsed = 0; // erase all prev. measurments
+  _running = false;  // of course not running.
+#endif
+}
+
 } /* namespace timer */
 #endif /* STOPWATCH_H */
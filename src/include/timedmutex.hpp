@@ -0,0 +1,346 @@
+/**
+ * timedmutex.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TIMED_MUTEX_H
+#define TIMED_MUTEX_H
+
+#include <stdint.h>
+#include <string>
+
+#include "stopwatch.hpp"
+#include "timer_config.hpp"
+
+namespace timer
+{
+
+/**
+ * Contention statistics of one TimedMutex. Only updated while the
+ * mutex is held, hence they need no synchronization of their own.
+ */
+struct SLockData
+{
+  uint64_t acquisitions; // lock() and successful try_lock()
+  uint64_t contended;    // acquisitions, that had to wait
+  uint64_t wait_time;    // microsec. waited in contended acquisitions
+  uint64_t max_wait;     // longest wait in microsec.
+  uint64_t hold_time;    // microsec. held after contended acquisitions
+  uint64_t cv_waits;     // waits on a condition variable
+  uint64_t cv_wait_time; // microsec. waited on the condition variable
+};
+
+namespace detail
+{
+/**
+ * Returns new statistics for a lock named 'name', reported at program
+ * exit by the collector of the ScopeTimer.
+ */
+SLockData* register_lock( const std::string& name );
+
+/**
+ * Adds the statistics of register_lock() to the total of their name,
+ * and releases them.
+ */
+void unregister_lock( SLockData* data );
+}
+
+/************************************************************************
+ * TimedMutex                                                           *
+ *   Wraps a mutex (anything with lock, try_lock and unlock) and        *
+ *   records how long threads wait for it. The statistics of all        *
+ *   TimedMutex with the same name are summed up and reported at        *
+ *   program exit with the ScopeTimer, ranked by total wait time. A     *
+ *   destroyed TimedMutex adds its statistics to the total of its       *
+ *   name, hence short-lived mutexes (e.g. one per connection) do not   *
+ *   accumulate entries.                                                *
+ *                                                                      *
+ *   lock() first tries try_lock(); only if that fails, the clock is    *
+ *   read before and after waiting, and the following hold time is      *
+ *   measured. Hence an uncontended acquisition costs a try_lock and    *
+ *   a counter increment, and the hold time is only known for           *
+ *   contended acquisitions, where it is what the waiters pay for.      *
+ *                                                                      *
+ *   wait() waits on a condition variable (it has to accept any         *
+ *   lock, e.g. std::condition_variable_any) and records the time. It   *
+ *   releases and re-acquires the wrapped mutex directly, hence the     *
+ *   wakeups are not counted as acquisitions; the hold time of a        *
+ *   contended acquisition ends at the wait.                            *
+ *                                                                      *
+ *   Usage example:                                                     *
+ *     TimedMutex< std::mutex > m( "queue" );                           *
+ *     std::condition_variable_any cv;                                  *
+ *     {                                                                *
+ *       std::unique_lock< TimedMutex< std::mutex > > l( m );           *
+ *       m.wait( cv, l, [&] { return not queue.empty(); } );            *
+ *       // ...                                                         *
+ *     }                                                                *
+ *   // output at program exit:                                         *
+ *   Lock contention (ranked by wait time)                              *
+ *             queue (acquired  10000, contended  1.5%) :: wait ...     *
+ ************************************************************************/
+template < class Mutex >
+class TimedMutex
+{
+public:
+  /**
+   * Creates an unlocked mutex named 'name'.
+   */
+  explicit TimedMutex( const std::string& name );
+
+  ~TimedMutex();
+
+  /**
+   * Acquires the mutex; measures the wait, if it is held by another thread.
+   */
+  void lock();
+
+  /**
+   * Tries to acquire the mutex without waiting.
+   */
+  bool try_lock();
+
+  /**
+   * Releases the mutex.
+   */
+  void unlock();
+
+  /**
+   * Waits on 'cv' with 'lock' holding this mutex, and records the time.
+   */
+  template < class CondVar, class Lock >
+  void wait( CondVar& cv, Lock& lock );
+
+  /**
+   * Waits on 'cv' with 'lock' holding this mutex until 'predicate' is
+   * true, and records the time.
+   */
+  template < class CondVar, class Lock, class Predicate >
+  void wait( CondVar& cv, Lock& lock, Predicate predicate );
+
+  /**
+   * Returns the wrapped mutex.
+   */
+  Mutex& native();
+
+private:
+  TimedMutex( const TimedMutex& );     // Don't Implement
+  void operator=( const TimedMutex& ); // Don't implement
+
+  Mutex _mutex;
+#if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER )
+  /**
+   * Locks the wrapped mutex without accounting, for the condition
+   * variable in wait().
+   */
+  struct SNativeLock
+  {
+    Mutex& mutex;
+
+    void
+    lock()
+    {
+      mutex.lock();
+    }
+
+    void
+    unlock()
+    {
+      mutex.unlock();
+    }
+  };
+
+  /**
+   * Accounts an acquisition, that waited 'wait' microsec. until 'now';
+   * called with the mutex held.
+   */
+  void acquired( Stopwatch::timestamp_t wait, Stopwatch::timestamp_t now );
+
+  std::string _name;
+  SLockData* _data;                  // registered at the first acquisition
+  Stopwatch::timestamp_t _contended; // acquisition time, if contended; else 0
+#endif
+};
+
+#if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER )
+template < class Mutex >
+TimedMutex< Mutex >::TimedMutex( const std::string& name )
+  : _mutex()
+  , _name( name )
+  , _data( 0 )
+  , _contended( 0 )
+{
+}
+
+template < class Mutex >
+TimedMutex< Mutex >::~TimedMutex()
+{
+  if ( _data != 0 )
+  {
+    detail::unregister_lock( _data );
+  }
+}
+
+template < class Mutex >
+inline void
+TimedMutex< Mutex >::lock()
+{
+  if ( _mutex.try_lock() )
+  {
+    acquired( 0, 0 );
+    return;
+  }
+  Stopwatch::timestamp_t begin = Stopwatch::get_timestamp();
+  _mutex.lock();
+  Stopwatch::timestamp_t now = Stopwatch::get_timestamp();
+  acquired( now - begin, now );
+}
+
+template < class Mutex >
+inline bool
+TimedMutex< Mutex >::try_lock()
+{
+  if ( _mutex.try_lock() )
+  {
+    acquired( 0, 0 );
+    return true;
+  }
+  return false;
+}
+
+template < class Mutex >
+inline void
+TimedMutex< Mutex >::unlock()
+{
+  if ( _contended != 0 )
+  {
+    _data->hold_time += Stopwatch::get_timestamp() - _contended;
+    _contended = 0;
+  }
+  _mutex.unlock();
+}
+
+template < class Mutex >
+template < class CondVar, class Lock >
+void
+TimedMutex< Mutex >::wait( CondVar& cv, Lock& )
+{
+  Stopwatch::timestamp_t begin = Stopwatch::get_timestamp();
+  if ( _contended != 0 )
+  {
+    // the mutex is released while waiting
+    _data->hold_time += begin - _contended;
+    _contended = 0;
+  }
+  // 'lock' stays owned; the wrapped mutex is released and re-acquired
+  // bypassing lock() and unlock(), which would count every wakeup
+  SNativeLock native = { _mutex };
+  cv.wait( native );
+  // the mutex is held again
+  ++_data->cv_waits;
+  _data->cv_wait_time += Stopwatch::get_timestamp() - begin;
+}
+
+template < class Mutex >
+inline void
+TimedMutex< Mutex >::acquired( Stopwatch::timestamp_t wait, Stopwatch::timestamp_t now )
+{
+  if ( _data == 0 )
+  {
+    _data = detail::register_lock( _name );
+  }
+  ++_data->acquisitions;
+  if ( now != 0 )
+  {
+    ++_data->contended;
+    _data->wait_time += wait;
+    if ( wait > _data->max_wait )
+    {
+      _data->max_wait = wait;
+    }
+    _contended = now;
+  }
+}
+#else
+template < class Mutex >
+TimedMutex< Mutex >::TimedMutex( const std::string& )
+  : _mutex()
+{
+}
+
+template < class Mutex >
+TimedMutex< Mutex >::~TimedMutex()
+{
+}
+
+template < class Mutex >
+inline void
+TimedMutex< Mutex >::lock()
+{
+  _mutex.lock();
+}
+
+template < class Mutex >
+inline bool
+TimedMutex< Mutex >::try_lock()
+{
+  return _mutex.try_lock();
+}
+
+template < class Mutex >
+inline void
+TimedMutex< Mutex >::unlock()
+{
+  _mutex.unlock();
+}
+
+template < class Mutex >
+template < class CondVar, class Lock >
+void
+TimedMutex< Mutex >::wait( CondVar& cv, Lock& lock )
+{
+  cv.wait( lock );
+}
+#endif
+
+template < class Mutex >
+template < class CondVar, class Lock, class Predicate >
+void
+TimedMutex< Mutex >::wait( CondVar& cv, Lock& lock, Predicate predicate )
+{
+  while ( not predicate() )
+  {
+    wait( cv, lock );
+  }
+}
+
+template < class Mutex >
+inline Mutex&
+TimedMutex< Mutex >::native()
+{
+  return _mutex;
+}
+
+} /* namespace timer */
+#endif /* TIMED_MUTEX_H */
@@ -0,0 +1,167 @@
+/**
+ * loaddriver.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "loaddriver.hpp"
+
+#include <cassert>
+#include <errno.h>
+#include <time.h>
+
+namespace timer
+{
+std::ostream&
+operator<<( std::ostream& os, const LoadResult& result )
+{
+  result.print( "", Stopwatch::MICROSEC, os );
+  return os;
+}
+}
+
+uint64_t
+timer::detail::monotonic_ns()
+{
+#ifdef HAVE_CLOCK_NANOSLEEP
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  return ( uint64_t ) now.tv_sec * 1000000000 + now.tv_nsec;
+#else
+  return Stopwatch::get_timestamp() * 1000;
+#endif
+}
+
+void
+timer::detail::wait_until( uint64_t deadline, uint64_t spin )
+{
+  uint64_t now = monotonic_ns();
+  if ( now + spin < deadline )
+  {
+#ifdef HAVE_CLOCK_NANOSLEEP
+    struct timespec wakeup;
+    wakeup.tv_sec = ( deadline - spin ) / 1000000000;
+    wakeup.tv_nsec = ( deadline - spin ) % 1000000000;
+    while ( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, 0 ) == EINTR )
+    {
+    }
+#else
+    struct timespec duration;
+    duration.tv_sec = ( deadline - spin - now ) / 1000000000;
+    duration.tv_nsec = ( deadline - spin - now ) % 1000000000;
+    nanosleep( &duration, 0 );
+#endif
+  }
+  // the wakeup is late by the scheduling latency; spin the rest
+  while ( monotonic_ns() < deadline )
+  {
+  }
+}
+
+timer::SLoadOptions::SLoadOptions()
+  : duration( 5.0 )
+  , threads( 0 )
+  , spin( 50.0 )
+{
+}
+
+timer::LoadResult::LoadResult( const std::string& name,
+  double rate,
+  double elapsed,
+  uint64_t late,
+  const SeriesTimer& latencies )
+  : _name( name )
+  , _rate( rate )
+  , _elapsed( elapsed )
+  , _late( late )
+  , _latencies( latencies )
+{
+}
+
+const std::string&
+timer::LoadResult::name() const
+{
+  return _name;
+}
+
+double
+timer::LoadResult::rate() const
+{
+  return _rate;
+}
+
+double
+timer::LoadResult::throughput() const
+{
+  return _elapsed > 0.0 ? _latencies.size() / _elapsed : 0.0;
+}
+
+uint64_t
+timer::LoadResult::late() const
+{
+  return _late;
+}
+
+const timer::SeriesTimer&
+timer::LoadResult::latencies() const
+{
+  return _latencies;
+}
+
+void
+timer::LoadResult::print( const char* msg, Stopwatch::timeunit_t timeunit, std::ostream& os ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+
+  const char* unit = "";
+  switch ( timeunit )
+  {
+    case Stopwatch::MICROSEC:
+      unit = " microsec.";
+      break;
+    case Stopwatch::MILLISEC:
+      unit = " millisec.";
+      break;
+    case Stopwatch::SECONDS:
+      unit = " sec.";
+      break;
+    case Stopwatch::MINUTES:
+      unit = " min.";
+      break;
+    case Stopwatch::HOURS:
+      unit = " h.";
+      break;
+    case Stopwatch::DAYS:
+      unit = " days.";
+      break;
+  }
+  os << msg << _name << " @ " << _rate << "/s: " << throughput() << "/s, " << _late << " late";
+  if ( _latencies.size() > 0 )
+  {
+    os << ", latency p50 " << _latencies.quantile( 0.5, timeunit ) << " p90 "
+       << _latencies.quantile( 0.9, timeunit ) << " p99 " << _latencies.quantile( 0.99, timeunit )
+       << " p99.9 " << _latencies.quantile( 0.999, timeunit ) << " max "
+       << _latencies.quantile( 1.0, timeunit ) << unit;
+  }
+  os << " (" << _latencies.size() << " requests)" << std::endl;
+}
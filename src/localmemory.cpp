@@ -0,0 +1,301 @@
+/**
+ * localmemory.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "localmemory.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+namespace
+{
+size_t
+cache_lines( size_t bytes )
+{
+  return ( bytes + timer::detail::CACHE_LINE - 1 ) / timer::detail::CACHE_LINE
+    * timer::detail::CACHE_LINE;
+}
+
+#ifdef HAVE_LIBNUMA
+/**
+ * Local memory of a thread, that the small objects of local_allocate()
+ * are carved from, instead of mapping pages for each. Each object is
+ * preceded by a cache line with its block. The block is released, when
+ * all its objects are freed and its thread does not use it any more.
+ */
+struct SLocalBlock
+{
+  size_t references; // objects, + 1 while the thread carves from it
+  char* next;
+  char* end;
+};
+
+const size_t LOCAL_BLOCK_SIZE = 64 * 1024;
+const size_t MAX_CARVED = LOCAL_BLOCK_SIZE / 4; // larger are mapped on their own
+__thread SLocalBlock* local_block = 0;
+
+void
+release_block( SLocalBlock* block )
+{
+  if ( __atomic_sub_fetch( &block->references, 1, __ATOMIC_ACQ_REL ) == 0 )
+  {
+    numa_free( block, LOCAL_BLOCK_SIZE );
+  }
+}
+
+/**
+ * Returns 'bytes' (whole cache lines, at most MAX_CARVED) from the
+ * block of the calling thread.
+ */
+void*
+carve( size_t bytes )
+{
+  const size_t line = timer::detail::CACHE_LINE;
+  SLocalBlock* block = local_block;
+  if ( block == 0 || line + bytes > ( size_t )( block->end - block->next ) )
+  {
+    char* memory = static_cast< char* >( numa_alloc_local( LOCAL_BLOCK_SIZE ) );
+    if ( memory == 0 )
+    {
+      throw std::bad_alloc();
+    }
+    if ( block != 0 )
+    {
+      release_block( block );
+    }
+    block = reinterpret_cast< SLocalBlock* >( memory );
+    block->references = 1;
+    block->next = memory + line; // the header on a cache line of its own
+    block->end = memory + LOCAL_BLOCK_SIZE;
+    local_block = block;
+  }
+  char* prefix = block->next;
+  *reinterpret_cast< SLocalBlock** >( prefix ) = block;
+  block->next += line + bytes;
+  __atomic_add_fetch( &block->references, 1, __ATOMIC_RELAXED );
+  return prefix + line;
+}
+
+/**
+ * Frees an object of carve(), from any thread.
+ */
+void
+uncarve( void* memory )
+{
+  char* prefix = static_cast< char* >( memory ) - timer::detail::CACHE_LINE;
+  release_block( *reinterpret_cast< SLocalBlock** >( prefix ) );
+}
+#endif
+
+const size_t NO_SLOT = ~( size_t ) 0;
+__thread size_t slot_of_thread = NO_SLOT;
+size_t next_slot = 0; // never used before
+
+#ifdef HAVE_PTHREAD
+pthread_mutex_t free_slots_lock = PTHREAD_MUTEX_INITIALIZER;
+std::vector< size_t >* free_slots = 0; // of exited threads; never deleted
+pthread_key_t slot_key;
+pthread_once_t slot_key_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Returns the slot 'value' (slot + 1) of an exiting thread, and its
+ * block of local memory.
+ */
+void
+release_slot( void* value )
+{
+#ifdef HAVE_LIBNUMA
+  if ( local_block != 0 )
+  {
+    release_block( local_block );
+    local_block = 0;
+  }
+#endif
+  pthread_mutex_lock( &free_slots_lock );
+  if ( free_slots == 0 )
+  {
+    free_slots = new std::vector< size_t >();
+  }
+  free_slots->push_back( ( size_t ) value - 1 );
+  pthread_mutex_unlock( &free_slots_lock );
+  slot_of_thread = NO_SLOT;
+}
+
+void
+lock_free_slots()
+{
+  pthread_mutex_lock( &free_slots_lock );
+}
+
+void
+unlock_free_slots()
+{
+  pthread_mutex_unlock( &free_slots_lock );
+}
+
+void
+create_slot_key()
+{
+  pthread_key_create( &slot_key, &release_slot );
+  // the child of fork() must not inherit the lock held
+  pthread_atfork( &lock_free_slots, &unlock_free_slots, &unlock_free_slots );
+}
+#endif
+
+/**
+ * Returns a slot, that no living thread uses.
+ */
+size_t
+acquire_slot()
+{
+  size_t slot;
+#ifdef HAVE_PTHREAD
+  pthread_once( &slot_key_once, &create_slot_key );
+  pthread_mutex_lock( &free_slots_lock );
+  if ( free_slots != 0 && not free_slots->empty() )
+  {
+    slot = free_slots->back();
+    free_slots->pop_back();
+  }
+  else
+  {
+    slot = next_slot++;
+  }
+  pthread_mutex_unlock( &free_slots_lock );
+  // not 0, such that release_slot() is called
+  pthread_setspecific( slot_key, ( void* )( slot + 1 ) );
+#else
+  slot = __atomic_fetch_add( &next_slot, 1, __ATOMIC_RELAXED );
+#endif
+  return slot;
+}
+}
+
+size_t
+timer::detail::thread_slot()
+{
+  if ( slot_of_thread == NO_SLOT )
+  {
+    slot_of_thread = acquire_slot();
+  }
+  return slot_of_thread;
+}
+
+void*
+timer::detail::local_allocate( size_t bytes )
+{
+  bytes = cache_lines( bytes );
+#ifdef HAVE_LIBNUMA
+  if ( numa_available() >= 0 )
+  {
+    if ( bytes <= MAX_CARVED )
+    {
+      return carve( bytes );
+    }
+    // page aligned
+    void* memory = numa_alloc_local( bytes );
+    if ( memory == 0 )
+    {
+      throw std::bad_alloc();
+    }
+    return memory;
+  }
+#endif
+#ifdef HAVE_POSIX_MEMALIGN
+  void* memory = 0;
+  if ( posix_memalign( &memory, CACHE_LINE, bytes ) != 0 )
+  {
+    throw std::bad_alloc();
+  }
+  return memory;
+#else
+  return ::operator new( bytes );
+#endif
+}
+
+void
+timer::detail::local_free( void* memory, size_t bytes )
+{
+#ifdef HAVE_LIBNUMA
+  if ( numa_available() >= 0 )
+  {
+    bytes = cache_lines( bytes );
+    if ( bytes <= MAX_CARVED )
+    {
+      uncarve( memory );
+      return;
+    }
+    numa_free( memory, bytes );
+    return;
+  }
+#endif
+#ifdef HAVE_POSIX_MEMALIGN
+  ( void ) bytes;
+  free( memory );
+#else
+  ( void ) bytes;
+  ::operator delete( memory );
+#endif
+}
+
+timer::detail::Arena::Arena()
+  : _chunks()
+  , _next( 0 )
+  , _end( 0 )
+{
+}
+
+timer::detail::Arena::~Arena()
+{
+  for ( size_t i = 0; i < _chunks.size(); ++i )
+  {
+    local_free( _chunks[ i ].first, _chunks[ i ].second );
+  }
+}
+
+void*
+timer::detail::Arena::allocate( size_t bytes )
+{
+  bytes = ( bytes + ALIGNMENT - 1 ) / ALIGNMENT * ALIGNMENT;
+  if ( bytes > ( size_t )( _end - _next ) )
+  {
+    size_t size = std::max( bytes, ( size_t ) CHUNK_SIZE );
+    _chunks.reserve( _chunks.size() + 1 );
+    _next = static_cast< char* >( local_allocate( size ) );
+    _end = _next + size;
+    _chunks.push_back( std::make_pair( _next, size ) );
+  }
+  void* result = _next;
+  _next += bytes;
+  return result;
+}
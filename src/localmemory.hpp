@@ -0,0 +1,339 @@
+/**
+ * localmemory.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * Internal helpers for per-thread state: memory on the NUMA node of
+ * the calling thread, cache line aligned, and an arena for the nodes
+ * of per-thread containers; not installed.
+ */
+
+#ifndef LOCAL_MEMORY_H
+#define LOCAL_MEMORY_H
+
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "timer_config.hpp"
+
+namespace timer
+{
+namespace detail
+{
+
+const size_t CACHE_LINE = 64;
+
+/**
+ * Returns the slot of the calling thread. Each thread (OpenMP, pthread
+ * or std::thread alike) gets its own slot at the first call; with
+ * pthreads, the slot is handed to a later thread after the thread
+ * exits, hence the slots stay about as many as threads are alive.
+ */
+size_t thread_slot();
+
+/**
+ * Per-thread entries (pointers to T), indexed by thread_slot(). The
+ * entries are in chunks of CHUNK_SLOTS, that are appended when a
+ * thread with a higher slot appears, hence any number of threads is
+ * supported. Chunks are never moved or released before the table;
+ * the entries are read and written atomically by the users.
+ */
+template < class T >
+class SlotTable
+{
+public:
+  enum
+  {
+    CHUNK_SLOTS = 64
+  };
+
+  SlotTable()
+    : _first()
+    , _size( CHUNK_SLOTS )
+  {
+  }
+
+  /**
+   * Releases the chunks, but not the entries.
+   */
+  ~SlotTable()
+  {
+    SChunk* chunk = _first.next;
+    while ( chunk != 0 )
+    {
+      SChunk* next = chunk->next;
+      delete chunk;
+      chunk = next;
+    }
+  }
+
+  /**
+   * Returns the entry of 'slot'; appends chunks as needed. Thread-safe.
+   */
+  T**
+  entry( size_t slot )
+  {
+    SChunk* chunk = &_first;
+    for ( ; slot >= CHUNK_SLOTS; slot -= CHUNK_SLOTS )
+    {
+      SChunk* next = __atomic_load_n( &chunk->next, __ATOMIC_ACQUIRE );
+      if ( next == 0 )
+      {
+        SChunk* created = new SChunk();
+        if ( __atomic_compare_exchange_n(
+               &chunk->next, &next, created, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+        {
+          next = created;
+          __atomic_fetch_add( &_size, ( size_t ) CHUNK_SLOTS, __ATOMIC_RELEASE );
+        }
+        else
+        {
+          delete created; // appended by another thread
+        }
+      }
+      chunk = next;
+    }
+    return &chunk->entries[ slot ];
+  }
+
+  /**
+   * Returns the entry of 'slot', or 0, if there is none yet.
+   */
+  T*
+  get( size_t slot ) const
+  {
+    const SChunk* chunk = &_first;
+    for ( ; slot >= CHUNK_SLOTS && chunk != 0; slot -= CHUNK_SLOTS )
+    {
+      chunk = __atomic_load_n( &chunk->next, __ATOMIC_ACQUIRE );
+    }
+    return chunk != 0 ? __atomic_load_n( &chunk->entries[ slot ], __ATOMIC_ACQUIRE ) : 0;
+  }
+
+  /**
+   * Returns the number of slots in the chunks so far.
+   */
+  size_t
+  size() const
+  {
+    return __atomic_load_n( &_size, __ATOMIC_ACQUIRE );
+  }
+
+private:
+  SlotTable( const SlotTable& );      // Don't Implement
+  void operator=( const SlotTable& ); // Don't implement
+
+  struct SChunk
+  {
+    T* entries[ CHUNK_SLOTS ];
+    SChunk* next;
+  };
+
+  SChunk _first;
+  size_t _size;
+};
+
+/**
+ * Returns 'bytes' (rounded up to whole cache lines) of memory, that
+ * is cache line aligned and on the NUMA node of the calling thread:
+ * with libnuma from numa_alloc_local() (small objects are carved from
+ * a block of local memory per thread), otherwise the pages are placed
+ * by the first touch, hence the calling thread should initialize it.
+ * Throws std::bad_alloc.
+ */
+void* local_allocate( size_t bytes );
+
+/**
+ * Releases memory of local_allocate( bytes ).
+ */
+void local_free( void* memory, size_t bytes );
+
+/**
+ * Creates a T in local memory of the calling thread.
+ */
+template < class T >
+T*
+local_new()
+{
+  void* memory = local_allocate( sizeof( T ) );
+  try
+  {
+    return new ( memory ) T();
+  }
+  catch ( ... )
+  {
+    local_free( memory, sizeof( T ) );
+    throw;
+  }
+}
+
+/**
+ * Destroys a T of local_new().
+ */
+template < class T >
+void
+local_delete( T* object )
+{
+  if ( object != 0 )
+  {
+    object->~T();
+    local_free( object, sizeof( T ) );
+  }
+}
+
+/**
+ * Bump allocator in chunks of local memory of the thread, that
+ * allocates first. Memory is only released with the arena; for
+ * containers, that grow only (e.g. maps of names). Not thread-safe.
+ */
+class Arena
+{
+public:
+  enum
+  {
+    CHUNK_SIZE = 64 * 1024,
+    ALIGNMENT = 16
+  };
+
+  Arena();
+  ~Arena();
+
+  /**
+   * Returns 'bytes' of memory aligned to ALIGNMENT.
+   */
+  void* allocate( size_t bytes );
+
+private:
+  Arena( const Arena& );          // Don't Implement
+  void operator=( const Arena& ); // Don't implement
+
+  std::vector< std::pair< char*, size_t > > _chunks; // and their sizes
+  char* _next;
+  char* _end;
+};
+
+/**
+ * Standard allocator of an Arena; deallocate() is a no-op.
+ */
+template < class T >
+class ArenaAllocator
+{
+public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template < class U >
+  struct rebind
+  {
+    typedef ArenaAllocator< U > other;
+  };
+
+  explicit ArenaAllocator( Arena* arena )
+    : _arena( arena )
+  {
+  }
+
+  template < class U >
+  ArenaAllocator( const ArenaAllocator< U >& other )
+    : _arena( other.arena() )
+  {
+  }
+
+  Arena*
+  arena() const
+  {
+    return _arena;
+  }
+
+  pointer
+  address( reference value ) const
+  {
+    return &value;
+  }
+
+  const_pointer
+  address( const_reference value ) const
+  {
+    return &value;
+  }
+
+  pointer
+  allocate( size_type n, const void* = 0 )
+  {
+    return static_cast< pointer >( _arena->allocate( n * sizeof( T ) ) );
+  }
+
+  void
+  deallocate( pointer, size_type )
+  {
+  }
+
+  size_type
+  max_size() const
+  {
+    return ( size_t ) -1 / sizeof( T );
+  }
+
+  void
+  construct( pointer p, const T& value )
+  {
+    new ( p ) T( value );
+  }
+
+  void
+  destroy( pointer p )
+  {
+    p->~T();
+  }
+
+private:
+  Arena* _arena;
+};
+
+template < class T, class U >
+inline bool
+operator==( const ArenaAllocator< T >& a, const ArenaAllocator< U >& b )
+{
+  return a.arena() == b.arena();
+}
+
+template < class T, class U >
+inline bool
+operator!=( const ArenaAllocator< T >& a, const ArenaAllocator< U >& b )
+{
+  return a.arena() != b.arena();
+}
+
+} /* namespace detail */
+} /* namespace timer */
+#endif /* LOCAL_MEMORY_H */
@@ -0,0 +1,454 @@
+/**
+ * mappedseries.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "mappedseries.hpp"
+#include "bootstrap.hpp"
+#include "packedsamples.hpp"
+#include "seriesformat.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+timer::MappedSeries::MappedSeries()
+  : _data( 0 )
+  , _length( 0 )
+  , _mapped( false )
+  , _encoding( SeriesTimer::RAW )
+  , _count( 0 )
+  , _payload( 0 )
+  , _blocks()
+{
+}
+
+timer::MappedSeries::MappedSeries( const std::string& path )
+  : _data( 0 )
+  , _length( 0 )
+  , _mapped( false )
+  , _encoding( SeriesTimer::RAW )
+  , _count( 0 )
+  , _payload( 0 )
+  , _blocks()
+{
+  open( path );
+}
+
+timer::MappedSeries::~MappedSeries()
+{
+  close();
+}
+
+bool
+timer::MappedSeries::open( const std::string& path )
+{
+  close();
+#ifdef HAVE_SYS_MMAN_H
+  int fd = ::open( path.c_str(), O_RDONLY );
+  if ( fd < 0 )
+  {
+    return false;
+  }
+  struct stat st;
+  if ( fstat( fd, &st ) == 0 && st.st_size > 0 )
+  {
+    void* data = mmap( 0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( data != MAP_FAILED )
+    {
+      _data = static_cast< char* >( data );
+      _length = st.st_size;
+      _mapped = true;
+    }
+  }
+  ::close( fd );
+#else
+  std::ifstream in( path.c_str(), std::ios::binary );
+  in.seekg( 0, std::ios::end );
+  std::streamoff length = in.tellg();
+  in.seekg( 0, std::ios::beg );
+  if ( in && length > 0 )
+  {
+    // uint64_t storage keeps the payload aligned
+    _data = reinterpret_cast< char* >( new uint64_t[ ( length + 7 ) / 8 ] );
+    _length = length;
+    in.read( _data, length );
+  }
+#endif
+  if ( _data == 0 )
+  {
+    return false;
+  }
+
+  // header of version 2, or magic, version and count of version 1
+  detail::SSeriesHeader header;
+  size_t payload = sizeof( header );
+  if ( _length < 2 * sizeof( uint32_t ) + sizeof( uint64_t ) )
+  {
+    close();
+    return false;
+  }
+  std::memcpy( &header, _data, std::min( _length, sizeof( header ) ) );
+  if ( header.version == detail::SERIES_VERSION_1 )
+  {
+    std::memcpy( &header.count, _data + 2 * sizeof( uint32_t ), sizeof( header.count ) );
+    header.clock = detail::CLOCK_GETTIMEOFDAY;
+    header.encoding = detail::ENCODING_PACKED;
+    header.unit = 1;
+    header.version = detail::SERIES_VERSION;
+    payload = 2 * sizeof( uint32_t ) + sizeof( uint64_t );
+  }
+  if ( _length < payload || not detail::valid_header( header ) )
+  {
+    close();
+    return false;
+  }
+
+  _count = header.count;
+  _payload = reinterpret_cast< const uint64_t* >( _data + payload );
+  size_t words = ( _length - payload ) / sizeof( uint64_t );
+  if ( header.encoding == detail::ENCODING_RAW )
+  {
+    _encoding = SeriesTimer::RAW;
+    if ( words < _count )
+    {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  // index and check the block records, without decoding
+  _encoding = SeriesTimer::PACKED;
+  if ( words < 1 )
+  {
+    close();
+    return false;
+  }
+  uint64_t num_blocks = _payload[ 0 ];
+  if ( num_blocks > ( words - 1 ) / PackedSamples::HEADER_WORDS )
+  {
+    // more blocks than their headers fit in the file
+    close();
+    return false;
+  }
+  uint64_t count = 0;
+  size_t offset = 1;
+  _blocks.reserve( num_blocks );
+  for ( uint64_t b = 0; b < num_blocks; ++b )
+  {
+    if ( offset + PackedSamples::HEADER_WORDS > words )
+    {
+      close();
+      return false;
+    }
+    const uint64_t* record = _payload + offset;
+    size_t n = record[ 1 ] & 0xffffffff;
+    size_t width = record[ 1 ] >> 32;
+    if ( n == 0 || n > PackedSamples::BLOCK_SIZE || width > 64
+      || offset + PackedSamples::block_words( record ) > words )
+    {
+      close();
+      return false;
+    }
+    _blocks.push_back( offset );
+    count += n;
+    offset += PackedSamples::block_words( record );
+  }
+  if ( count != _count )
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void
+timer::MappedSeries::close()
+{
+#ifdef HAVE_SYS_MMAN_H
+  if ( _mapped )
+  {
+    munmap( _data, _length );
+  }
+#endif
+  if ( _data != 0 && not _mapped )
+  {
+    delete[] reinterpret_cast< uint64_t* >( _data );
+  }
+  _data = 0;
+  _length = 0;
+  _mapped = false;
+  _count = 0;
+  _payload = 0;
+  _blocks.clear();
+}
+
+bool
+timer::MappedSeries::isOpen() const
+{
+  return _data != 0;
+}
+
+timer::SeriesTimer::storage_t
+timer::MappedSeries::encoding() const
+{
+  return _encoding;
+}
+
+size_t
+timer::MappedSeries::size() const
+{
+  return _count;
+}
+
+double
+timer::MappedSeries::sum( Stopwatch::timeunit_t timeunit ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  double sum = 0.0;
+  std::vector< Stopwatch::timestamp_t > buf;
+  const Stopwatch::timestamp_t* data;
+  for ( size_t c = 0; c < chunks(); ++c )
+  {
+    size_t n = chunk( c, buf, data );
+    for ( size_t i = 0; i < n; ++i )
+    {
+      sum += data[ i ];
+    }
+  }
+  return sum / timeunit;
+}
+
+double
+timer::MappedSeries::mean( Stopwatch::timeunit_t timeunit ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  return _count > 0 ? sum( timeunit ) / _count : 0.0;
+}
+
+double
+timer::MappedSeries::std( Stopwatch::timeunit_t timeunit ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  if ( _count == 0 )
+  {
+    return 0.0;
+  }
+  double r = mean( timeunit );
+  double sum = 0;
+  std::vector< Stopwatch::timestamp_t > buf;
+  const Stopwatch::timestamp_t* data;
+  for ( size_t c = 0; c < chunks(); ++c )
+  {
+    size_t n = chunk( c, buf, data );
+    for ( size_t i = 0; i < n; ++i )
+    {
+      double tmp = 1.0 * data[ i ] / timeunit - r;
+      sum += tmp * tmp;
+    }
+  }
+  return std::sqrt( sum / _count );
+}
+
+double
+timer::MappedSeries::quantile( double q, Stopwatch::timeunit_t timeunit ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  assert( q >= 0.0 && q <= 1.0 );
+  if ( _count == 0 )
+  {
+    return 0.0;
+  }
+  // selection needs a modifiable copy
+  std::vector< Stopwatch::timestamp_t > local;
+  local.reserve( _count );
+  std::vector< Stopwatch::timestamp_t > buf;
+  const Stopwatch::timestamp_t* data;
+  for ( size_t c = 0; c < chunks(); ++c )
+  {
+    size_t n = chunk( c, buf, data );
+    local.insert( local.end(), data, data + n );
+  }
+  std::vector< Stopwatch::timestamp_t >::iterator it
+    = local.begin() + detail::quantile_index( q, local.size() );
+  std::nth_element( local.begin(), it, local.end() );
+  return 1.0 * *it / timeunit;
+}
+
+timer::SeriesTimer
+timer::MappedSeries::series( SeriesTimer::storage_t storage ) const
+{
+  SeriesTimer result( storage );
+#ifdef ENABLE_TIMING
+  if ( storage == SeriesTimer::PACKED && _encoding == SeriesTimer::PACKED )
+  {
+    for ( size_t b = 0; b < _blocks.size(); ++b )
+    {
+      result._packed.append_block( _payload + _blocks[ b ] );
+    }
+    return result;
+  }
+  std::vector< Stopwatch::timestamp_t > buf;
+  const Stopwatch::timestamp_t* data;
+  for ( size_t c = 0; c < chunks(); ++c )
+  {
+    size_t n = chunk( c, buf, data );
+    for ( size_t i = 0; i < n; ++i )
+    {
+      result.record( data[ i ] );
+    }
+  }
+#endif
+  return result;
+}
+
+bool
+timer::MappedSeries::concat( const std::vector< std::string >& inputs, const std::string& output )
+{
+  std::vector< MappedSeries* > series;
+  bool valid = true;
+  bool raw = true;
+  uint64_t count = 0;
+  uint64_t records = 0;
+  for ( size_t i = 0; i < inputs.size() && valid; ++i )
+  {
+    series.push_back( new MappedSeries( inputs[ i ] ) );
+    valid = series.back()->isOpen();
+    raw = raw && series.back()->encoding() == SeriesTimer::RAW;
+    count += series.back()->size();
+    records += series.back()->records();
+  }
+
+  // written beside 'output' and renamed at the end, hence 'output' may
+  // be one of the (mapped) inputs, and stays intact if writing fails
+  std::string temporary = output + ".tmp";
+  if ( valid )
+  {
+    std::ofstream out( temporary.c_str(), std::ios::binary );
+    detail::SSeriesHeader header
+      = detail::series_header( raw ? detail::ENCODING_RAW : detail::ENCODING_PACKED, count );
+    out.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+    if ( not raw )
+    {
+      out.write( reinterpret_cast< const char* >( &records ), sizeof( records ) );
+    }
+    for ( size_t i = 0; i < series.size(); ++i )
+    {
+      if ( raw )
+      {
+        out.write( reinterpret_cast< const char* >( series[ i ]->_payload ),
+          series[ i ]->_count * sizeof( uint64_t ) );
+      }
+      else
+      {
+        series[ i ]->write_records( out );
+      }
+    }
+    out.close();
+    valid = not out.fail() && std::rename( temporary.c_str(), output.c_str() ) == 0;
+    if ( not valid )
+    {
+      std::remove( temporary.c_str() );
+    }
+  }
+
+  for ( size_t i = 0; i < series.size(); ++i )
+  {
+    delete series[ i ];
+  }
+  return valid;
+}
+
+size_t
+timer::MappedSeries::chunks() const
+{
+  if ( _encoding == SeriesTimer::PACKED )
+  {
+    return _blocks.size();
+  }
+  return _count > 0 ? 1 : 0;
+}
+
+size_t
+timer::MappedSeries::chunk( size_t c,
+  std::vector< Stopwatch::timestamp_t >& buf,
+  const Stopwatch::timestamp_t*& data ) const
+{
+  if ( _encoding == SeriesTimer::PACKED )
+  {
+    buf.resize( PackedSamples::BLOCK_SIZE );
+    data = &buf[ 0 ];
+    return PackedSamples::decode_block( _payload + _blocks[ c ], &buf[ 0 ] );
+  }
+  // the raw timings in the mapping are a single chunk
+  data = _payload;
+  return _count;
+}
+
+size_t
+timer::MappedSeries::records() const
+{
+  if ( _encoding == SeriesTimer::PACKED )
+  {
+    return _blocks.size();
+  }
+  return ( _count + PackedSamples::BLOCK_SIZE - 1 ) / PackedSamples::BLOCK_SIZE;
+}
+
+void
+timer::MappedSeries::write_records( std::ostream& os ) const
+{
+  if ( _encoding == SeriesTimer::PACKED )
+  {
+    // the records are consecutive, hence written at once
+    if ( not _blocks.empty() )
+    {
+      const uint64_t* last = _payload + _blocks.back();
+      const uint64_t* end = last + PackedSamples::block_words( last );
+      const uint64_t* begin = _payload + _blocks.front();
+      os.write( reinterpret_cast< const char* >( begin ), ( end - begin ) * sizeof( uint64_t ) );
+    }
+    return;
+  }
+  // raw timings are encoded, not decoded
+  std::vector< uint64_t > words;
+  for ( uint64_t i = 0; i < _count; i += PackedSamples::BLOCK_SIZE )
+  {
+    words.clear();
+    size_t n = std::min( ( uint64_t ) PackedSamples::BLOCK_SIZE, _count - i );
+    PackedSamples::encode_block( _payload + i, n, words );
+    os.write( reinterpret_cast< const char* >( &words[ 0 ] ), words.size() * sizeof( uint64_t ) );
+  }
+}
@@ -0,0 +1,258 @@
+/**
+ * metricsserver.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "metricsserver.hpp"
+#include "scopetimer.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#if defined( HAVE_PTHREAD ) && defined( HAVE_SYS_SOCKET_H )
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+/**
+ * State of the server; plain data, hence valid during the whole
+ * program, also when the ScopeTimeCollector stops it at exit.
+ */
+struct SServer
+{
+  pthread_t thread;
+  int socket;
+  int running;
+  int atfork; // the fork handler is registered
+};
+
+SServer server;
+
+const int POLL_INTERVAL = 100; // millisec. until 'running' is checked again
+
+// a scraper, that disconnects early, must not kill the process by SIGPIPE
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0; // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+/**
+ * Writes all of 'data' to the socket 'fd'; returns false on errors.
+ */
+bool
+write_all( int fd, const char* data, size_t size )
+{
+  while ( size > 0 )
+  {
+    ssize_t n = send( fd, data, size, SEND_FLAGS );
+    if ( n < 0 && errno == EINTR )
+    {
+      continue;
+    }
+    if ( n <= 0 )
+    {
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+/**
+ * Reads the request header and answers it.
+ */
+void
+serve( int fd, std::string& body, std::string& response )
+{
+  char request[ 4096 ];
+  size_t size = 0;
+  while ( size < sizeof( request ) - 1 )
+  {
+    struct pollfd p = { fd, POLLIN, 0 };
+    if ( poll( &p, 1, 1000 ) <= 0 )
+    {
+      return;
+    }
+    ssize_t n = read( fd, request + size, sizeof( request ) - 1 - size );
+    if ( n < 0 && errno == EINTR )
+    {
+      continue;
+    }
+    if ( n <= 0 )
+    {
+      return;
+    }
+    size += n;
+    request[ size ] = 0;
+    if ( std::strstr( request, "\r\n\r\n" ) != 0 || std::strstr( request, "\n\n" ) != 0 )
+    {
+      break;
+    }
+  }
+
+  const char* status;
+  const char* type;
+  if ( std::strncmp( request, "GET /metrics ", 13 ) == 0
+    || std::strncmp( request, "GET /metrics?", 13 ) == 0 )
+  {
+    timer::render_openmetrics( body );
+    status = "200 OK";
+    type = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+  }
+  else
+  {
+    body = "Not found; see /metrics\n";
+    status = "404 Not Found";
+    type = "text/plain; charset=utf-8";
+  }
+
+  char length[ 32 ];
+  snprintf( length, sizeof( length ), "%lu", ( unsigned long ) body.size() );
+  response = "HTTP/1.0 ";
+  response += status;
+  response += "\r\nContent-Type: ";
+  response += type;
+  response += "\r\nContent-Length: ";
+  response += length;
+  response += "\r\nConnection: close\r\n\r\n";
+  if ( write_all( fd, response.data(), response.size() ) )
+  {
+    write_all( fd, body.data(), body.size() );
+  }
+}
+
+/**
+ * The server thread does not exist in the child of fork(), hence the
+ * child closes its copy of the socket and does not serve.
+ */
+void
+server_fork_child()
+{
+  if ( server.running )
+  {
+    server.running = 0;
+    close( server.socket );
+  }
+}
+
+void*
+server_main( void* )
+{
+  // reused for all requests
+  std::string body;
+  std::string response;
+  while ( __atomic_load_n( &server.running, __ATOMIC_ACQUIRE ) )
+  {
+    struct pollfd p = { server.socket, POLLIN, 0 };
+    if ( poll( &p, 1, POLL_INTERVAL ) <= 0 )
+    {
+      continue;
+    }
+    int fd = accept( server.socket, 0, 0 );
+    if ( fd >= 0 )
+    {
+#ifdef SO_NOSIGPIPE
+      int yes = 1;
+      setsockopt( fd, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof( yes ) );
+#endif
+      serve( fd, body, response );
+      close( fd );
+    }
+  }
+  return 0;
+}
+}
+
+bool
+timer::start_metrics_server( int port )
+{
+  if ( server.running )
+  {
+    return false;
+  }
+  if ( not server.atfork )
+  {
+    server.atfork = pthread_atfork( 0, 0, &server_fork_child ) == 0;
+  }
+  server.socket = socket( AF_INET, SOCK_STREAM, 0 );
+  if ( server.socket < 0 )
+  {
+    return false;
+  }
+  int yes = 1;
+  setsockopt( server.socket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof( yes ) );
+
+  struct sockaddr_in address;
+  std::memset( &address, 0, sizeof( address ) );
+  address.sin_family = AF_INET;
+  address.sin_port = htons( port );
+  address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  if ( bind( server.socket, ( struct sockaddr* ) &address, sizeof( address ) ) != 0
+    || listen( server.socket, 16 ) != 0 )
+  {
+    close( server.socket );
+    return false;
+  }
+
+  __atomic_store_n( &server.running, 1, __ATOMIC_RELEASE );
+  if ( pthread_create( &server.thread, 0, &server_main, 0 ) != 0 )
+  {
+    server.running = 0;
+    close( server.socket );
+    return false;
+  }
+  return true;
+}
+
+void
+timer::stop_metrics_server()
+{
+  if ( server.running )
+  {
+    __atomic_store_n( &server.running, 0, __ATOMIC_RELEASE );
+    pthread_join( server.thread, 0 );
+    close( server.socket );
+  }
+}
+#else
+bool
+timer::start_metrics_server( int )
+{
+  return false;
+}
+
+void
+timer::stop_metrics_server()
+{
+}
+#endif
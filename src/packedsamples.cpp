@@ -0,0 +1,279 @@
+/**
+ * packedsamples.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "packedsamples.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+timer::PackedSamples::PackedSamples()
+  : _words()
+  , _offsets()
+  , _tail()
+  , _size( 0 )
+{
+  _tail.reserve( BLOCK_SIZE );
+}
+
+void
+timer::PackedSamples::push_back( value_t value )
+{
+  _tail.push_back( value );
+  ++_size;
+  if ( _tail.size() == BLOCK_SIZE )
+  {
+    // block is full: pack it and start a new one
+    pack_tail();
+  }
+}
+
+size_t
+timer::PackedSamples::append_block( const uint64_t* record )
+{
+  size_t count = record[ 1 ] & 0xffffffff;
+  size_t words = block_words( record );
+  if ( count < BLOCK_SIZE )
+  {
+    // incomplete blocks (e.g. the end of a concatenated file) continue
+    // the unpacked last block, which is packed once it fills up
+    value_t buf[ BLOCK_SIZE ];
+    decode_block( record, buf );
+    for ( size_t i = 0; i < count; ++i )
+    {
+      push_back( buf[ i ] );
+    }
+    return words;
+  }
+
+  // complete blocks are copied as they are; the samples before them
+  // stay in front as an incomplete record
+  if ( not _tail.empty() )
+  {
+    pack_tail();
+  }
+  _offsets.push_back( _words.size() );
+  _words.insert( _words.end(), record, record + words );
+  _size += count;
+  return words;
+}
+
+void
+timer::PackedSamples::append( const PackedSamples& other )
+{
+  if ( &other == this )
+  {
+    PackedSamples copy( other );
+    append( copy );
+    return;
+  }
+  for ( size_t b = 0; b < other._offsets.size(); ++b )
+  {
+    append_block( &other._words[ other._offsets[ b ] ] );
+  }
+  for ( size_t i = 0; i < other._tail.size(); ++i )
+  {
+    push_back( other._tail[ i ] );
+  }
+}
+
+void
+timer::PackedSamples::pack_tail()
+{
+  _offsets.push_back( _words.size() );
+  encode_block( &_tail[ 0 ], _tail.size(), _words );
+  _tail.clear();
+}
+
+void
+timer::PackedSamples::clear()
+{
+  _words.clear();
+  _offsets.clear();
+  _tail.clear();
+  _size = 0;
+}
+
+size_t
+timer::PackedSamples::decode( size_t block, value_t* out ) const
+{
+  assert( block < blocks() );
+  if ( block < _offsets.size() )
+  {
+    return decode_block( &_words[ _offsets[ block ] ], out );
+  }
+  // the last block is not packed yet
+  std::copy( _tail.begin(), _tail.end(), out );
+  return _tail.size();
+}
+
+size_t
+timer::PackedSamples::bytes() const
+{
+  return _words.size() * sizeof( uint64_t ) + _offsets.size() * sizeof( size_t )
+    + _tail.size() * sizeof( value_t );
+}
+
+void
+timer::PackedSamples::write( std::ostream& os ) const
+{
+  std::vector< uint64_t > last;
+  if ( not _tail.empty() )
+  {
+    encode_block( &_tail[ 0 ], _tail.size(), last );
+  }
+
+  uint64_t num_blocks = blocks();
+  os.write( reinterpret_cast< const char* >( &num_blocks ), sizeof( num_blocks ) );
+  if ( not _words.empty() )
+  {
+    os.write( reinterpret_cast< const char* >( &_words[ 0 ] ), _words.size() * sizeof( uint64_t ) );
+  }
+  if ( not last.empty() )
+  {
+    os.write( reinterpret_cast< const char* >( &last[ 0 ] ), last.size() * sizeof( uint64_t ) );
+  }
+}
+
+bool
+timer::PackedSamples::read( std::istream& is )
+{
+  clear();
+
+  uint64_t num_blocks = 0;
+  if ( not is.read( reinterpret_cast< char* >( &num_blocks ), sizeof( num_blocks ) ) )
+  {
+    return false;
+  }
+
+  std::vector< uint64_t > record;
+  for ( uint64_t b = 0; b < num_blocks; ++b )
+  {
+    uint64_t header[ HEADER_WORDS ];
+    if ( not is.read( reinterpret_cast< char* >( header ), sizeof( header ) ) )
+    {
+      clear();
+      return false;
+    }
+    size_t count = header[ 1 ] & 0xffffffff;
+    size_t width = header[ 1 ] >> 32;
+    if ( count == 0 || count > BLOCK_SIZE || width > 64 )
+    {
+      clear();
+      return false;
+    }
+
+    size_t words = block_words( header );
+    record.resize( words );
+    record[ 0 ] = header[ 0 ];
+    record[ 1 ] = header[ 1 ];
+    if ( words > HEADER_WORDS
+      && not is.read( reinterpret_cast< char* >( &record[ HEADER_WORDS ] ),
+           ( words - HEADER_WORDS ) * sizeof( uint64_t ) ) )
+    {
+      clear();
+      return false;
+    }
+    append_block( &record[ 0 ] );
+  }
+  return true;
+}
+
+size_t
+timer::PackedSamples::encode_block( const value_t* in, size_t count, std::vector< uint64_t >& out )
+{
+  assert( count > 0 );
+  assert( count <= BLOCK_SIZE );
+
+  // frame of reference: store offsets to the block minimum
+  value_t base = *std::min_element( in, in + count );
+  value_t range = *std::max_element( in, in + count ) - base;
+  uint64_t width = 0;
+  while ( width < 64 && ( range >> width ) != 0 )
+  {
+    ++width;
+  }
+
+  size_t offset = out.size();
+  size_t words = HEADER_WORDS + ( count * width + 63 ) / 64;
+  out.resize( offset + words, 0 );
+  out[ offset ] = base;
+  out[ offset + 1 ] = ( uint64_t ) count | ( width << 32 );
+
+  uint64_t* packed = &out[ offset + HEADER_WORDS ];
+  for ( size_t i = 0; i < count && width > 0; ++i )
+  {
+    uint64_t v = in[ i ] - base;
+    size_t bit = i * width;
+    size_t w = bit >> 6;
+    size_t off = bit & 63;
+    packed[ w ] |= v << off;
+    if ( off + width > 64 )
+    {
+      packed[ w + 1 ] |= v >> ( 64 - off );
+    }
+  }
+  return words;
+}
+
+size_t
+timer::PackedSamples::decode_block( const uint64_t* record, value_t* out )
+{
+  const value_t base = record[ 0 ];
+  const size_t count = record[ 1 ] & 0xffffffff;
+  const size_t width = record[ 1 ] >> 32;
+  const uint64_t* packed = record + HEADER_WORDS;
+
+  if ( width == 0 )
+  {
+    std::fill( out, out + count, base );
+    return count;
+  }
+
+  // the width is fixed for the whole block, hence the loop has no
+  // data dependent control flow apart from words straddling a boundary
+  const uint64_t mask = width == 64 ? ~( uint64_t ) 0 : ( ( uint64_t ) 1 << width ) - 1;
+  for ( size_t i = 0; i < count; ++i )
+  {
+    size_t bit = i * width;
+    size_t w = bit >> 6;
+    size_t off = bit & 63;
+    uint64_t v = packed[ w ] >> off;
+    if ( off + width > 64 )
+    {
+      v |= packed[ w + 1 ] << ( 64 - off );
+    }
+    out[ i ] = base + ( v & mask );
+  }
+  return count;
+}
+
+size_t
+timer::PackedSamples::block_words( const uint64_t* record )
+{
+  const size_t count = record[ 1 ] & 0xffffffff;
+  const size_t width = record[ 1 ] >> 32;
+  return HEADER_WORDS + ( count * width + 63 ) / 64;
+}
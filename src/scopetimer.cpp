@@ -25,18 +25,269 @@
  */
 
 #include "scopetimer.hpp"
+#include "localmemory.hpp"
+#include "metricsserver.hpp"
+#include "span.hpp"
+#include "timedmutex.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
 #include <iomanip>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <stdint.h>
+#include <utility>
+#include <vector>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#ifdef HAVE_SIGACTION
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#endif
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+#if defined( HAVE_RUSAGE_THREAD )
+#include <sys/resource.h>
+#elif defined( HAVE_CLOCK_THREAD_CPUTIME_ID )
+#include <time.h>
+#endif
+
 namespace timer
 {
+#if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER )
+namespace
+{
+/**
+ * Guards the ScopeTimer data of one thread against readers on other
+ * threads, e.g. render_openmetrics(). Uncontended, except while a
+ * reader copies the data of this thread. An OpenMP lock, otherwise a
+ * pthread mutex, as threads may be pthreads or std::threads.
+ */
+class ThreadLock
+{
+public:
+  ThreadLock()
+  {
+#if defined( _OPENMP )
+    omp_init_lock( &_lock );
+#elif defined( HAVE_PTHREAD )
+    pthread_mutex_init( &_lock, 0 );
+#endif
+  }
+
+  ~ThreadLock()
+  {
+#if defined( _OPENMP )
+    omp_destroy_lock( &_lock );
+#elif defined( HAVE_PTHREAD )
+    pthread_mutex_destroy( &_lock );
+#endif
+  }
+
+  void
+  lock()
+  {
+#if defined( _OPENMP )
+    omp_set_lock( &_lock );
+#elif defined( HAVE_PTHREAD )
+    pthread_mutex_lock( &_lock );
+#endif
+  }
+
+  void
+  unlock()
+  {
+#if defined( _OPENMP )
+    omp_unset_lock( &_lock );
+#elif defined( HAVE_PTHREAD )
+    pthread_mutex_unlock( &_lock );
+#endif
+  }
+
+  /**
+   * Initializes the lock again, unlocked; for the child after fork(),
+   * where the owner of the lock may not exist.
+   */
+  void
+  reinit()
+  {
+#if defined( _OPENMP )
+    omp_init_lock( &_lock );
+#elif defined( HAVE_PTHREAD )
+    pthread_mutex_init( &_lock, 0 );
+#endif
+  }
+
+private:
+  ThreadLock( const ThreadLock& );     // Don't Implement
+  void operator=( const ThreadLock& ); // Don't implement
+
+#if defined( _OPENMP )
+  omp_lock_t _lock;
+#elif defined( HAVE_PTHREAD )
+  pthread_mutex_t _lock;
+#endif
+};
+
+/**
+ * Appends 'value' to 'buffer' as label value, i.e. with escaped
+ * backslash, double quote and newline.
+ */
+void
+append_label( std::string& buffer, const std::string& value )
+{
+  for ( size_t i = 0; i < value.size(); ++i )
+  {
+    switch ( value[ i ] )
+    {
+      case '\\':
+        buffer += "\\\\";
+        break;
+      case '"':
+        buffer += "\\\"";
+        break;
+      case '\n':
+        buffer += "\\n";
+        break;
+      default:
+        buffer += value[ i ];
+    }
+  }
+}
+
+/**
+ * Appends 'value' to 'buffer' with 15 significant digits.
+ */
+void
+append_number( std::string& buffer, double value )
+{
+  char text[ 32 ];
+  int length = snprintf( text, sizeof( text ), "%.15g", value );
+  buffer.append( text, length );
+}
+
+void
+append_number( std::string& buffer, uint64_t value )
+{
+  char text[ 32 ];
+  int length = snprintf( text, sizeof( text ), "%llu", ( unsigned long long ) value );
+  buffer.append( text, length );
+}
+
+/**
+ * Appends the labels of the scope 'name' of 'thread' to 'buffer',
+ * without the closing brace.
+ */
+void
+append_labels( std::string& buffer, const std::string& name, uint64_t thread )
+{
+  buffer += "{scope=\"";
+  append_label( buffer, name );
+  buffer += "\",thread=\"";
+  append_number( buffer, thread );
+  buffer += "\"";
+}
+
+#ifdef HAVE_SIGACTION
+/**
+ * Buffered output to a file descriptor with write(2) only, hence
+ * async-signal-safe: no allocation, no locale, no stdio.
+ */
+class SignalWriter
+{
+public:
+  explicit SignalWriter( int fd )
+    : _fd( fd )
+    , _size( 0 )
+  {
+  }
+
+  ~SignalWriter()
+  {
+    flush();
+  }
+
+  void
+  put( const char* text )
+  {
+    for ( ; *text != 0; ++text )
+    {
+      if ( _size == sizeof( _buffer ) )
+      {
+        flush();
+      }
+      _buffer[ _size++ ] = *text;
+    }
+  }
+
+  void
+  put( uint64_t value )
+  {
+    char digits[ 21 ];
+    size_t i = sizeof( digits ) - 1;
+    digits[ i ] = 0;
+    do
+    {
+      digits[ --i ] = '0' + value % 10;
+      value /= 10;
+    } while ( value > 0 );
+    put( digits + i );
+  }
+
+  void
+  flush()
+  {
+    size_t done = 0;
+    while ( done < _size )
+    {
+      ssize_t n = write( _fd, _buffer + done, _size - done );
+      if ( n < 0 && errno == EINTR )
+      {
+        continue;
+      }
+      if ( n <= 0 )
+      {
+        break;
+      }
+      done += n;
+    }
+    _size = 0;
+  }
+
+private:
+  SignalWriter( const SignalWriter& );   // Don't Implement
+  void operator=( const SignalWriter& ); // Don't implement
+
+  int _fd;
+  size_t _size;
+  char _buffer[ 1024 ];
+};
+#endif
+}
+#endif
+
+#if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER ) && defined( HAVE_PTHREAD )
+namespace
+{
+// pthread_atfork() handlers of the global ScopeTimeCollector
+void fork_prepare();
+void fork_parent();
+void fork_child();
+}
+#endif
+
 /***********************************************************************
  * ScopeTimeCollector                                                  *
  *   Collects the accumulated times of the named ScopeTimer in         *
@@ -46,9 +297,53 @@ namespace timer
  *   If compiled with OpenMP, the collector assignes the ScopeTimer    *
  *   data to the corresponding thread.                                 *
  *                                                                     *
+ *   The data of each thread has its own lock, hence threads do not    *
+ *   wait for each other when registering. It is allocated by the      *
+ *   thread itself on first use, in memory of its NUMA node, cache     *
+ *   line aligned and padded; the map nodes come from an arena of the  *
+ *   thread. Hence threads neither share cache lines nor access        *
+ *   remote memory when registering. render_openmetrics()              *
+ *   copies the data of one thread at a time under its lock, and       *
+ *   formats it afterwards, so that writers are held up only briefly.  *
+ *   The durations are additionally counted in log-scale buckets       *
+ *   (powers of 4 microseconds) for the histograms.                    *
+ *                                                                     *
  *   When the ScopeTimeCollector is deleted itself (most likely at     *
  *   the end of the program), it outputs the collected data to the     *
  *   std:cerr stream.                                                  *
+ *                                                                     *
+ *   At construction, the collector calibrates the overhead of a       *
+ *   measurement and of a complete ScopeTimer, which are reported      *
+ *   with the output and optionally subtracted from the timings.       *
+ *                                                                     *
+ *   For ScopeTimer with CPUTIME, the cpu time and context switches    *
+ *   are accumulated as well and reported with the cpu utilization,    *
+ *   i.e. the cpu time relative to the wall time of these calls.       *
+ *                                                                     *
+ *   ScopeTimer with a budget are published on a stack of active       *
+ *   scopes per thread. Only the owning thread writes it, guarded by   *
+ *   a sequence number (seqlock): odd while it is written. The         *
+ *   watchdog thread copies the stacks and retries, if the sequence    *
+ *   number was odd or changed meanwhile; hence neither side locks.    *
+ *   Scopes over budget at their end are kept in a bounded slow log.   *
+ *                                                                     *
+ *   Spans are collected by name for all threads, since a span may     *
+ *   begin and end on different threads.                               *
+ *                                                                     *
+ *   The collector also owns the statistics of each TimedMutex, and    *
+ *   reports them summed up by name and ranked by total wait time.     *
+ *                                                                     *
+ *   For dumps from a signal handler, each thread additionally         *
+ *   publishes the calls and time of its first MAX_PUBLISHED scopes    *
+ *   in a fixed table with a sequence number per entry, like the       *
+ *   active scopes. The handler copies the entries without locks and   *
+ *   gives up on an entry after some attempts, e.g. if the signal      *
+ *   interrupted the thread while writing it.                          *
+ *                                                                     *
+ *   At fork(), the locks are held, such that the child inherits       *
+ *   consistent data. The child initializes the locks again, since     *
+ *   their owners may not exist in it, and starts with empty data;     *
+ *   the watchdog and the metrics server do not run in the child.      *
  ***********************************************************************/
 #if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER )
 class ScopeTimeCollector
@@ -58,29 +353,166 @@ private:
    * Holds the data for ScopeTimer with same name
    * and on the same thread.
    */
+  static const size_t BUCKETS = 14; // <= 4^i microsec., i < 13, and +Inf
+
   struct SScopeData
   {
     double time;
     uint64_t num_calls;
+    uint64_t buckets[ BUCKETS ]; // not cumulative
+    double cpu_time;      // of the calls with CPUTIME
+    double cpu_wall_time; // wall time of the calls with CPUTIME
+    uint64_t cpu_calls;
+    uint64_t voluntary;   // context switches, e.g. blocking I/O or locks
+    uint64_t involuntary; // context switches by preemption
+    uint64_t published;   // 1 + index in the published scopes; 0: not yet
 
     SScopeData&
     update( double time )
     {
       this->time += time;
       ++num_calls;
+      double limit = 1.0 / Stopwatch::SECONDS;
+      size_t b = 0;
+      for ( ; b < BUCKETS - 1 && time > limit; ++b )
+      {
+        limit *= 4.0;
+      }
+      ++buckets[ b ];
+      return *this;
+    }
+
+    SScopeData&
+    update( double time, double cpu_time, uint64_t voluntary, uint64_t involuntary )
+    {
+      update( time );
+      this->cpu_time += cpu_time;
+      cpu_wall_time += time;
+      ++cpu_calls;
+      this->voluntary += voluntary;
+      this->involuntary += involuntary;
       return *this;
     }
   };
 
-  typedef std::map< std::string, SScopeData > mapping;
+  typedef detail::ArenaAllocator< std::pair< const std::string, SScopeData > > allocator;
+  typedef std::map< std::string, SScopeData, std::less< std::string >, allocator > mapping;
 
-  mapping* _timing_data;
-  uint64_t _threads;
-  Stopwatch _sw_overall;
+  /**
+   * Holds the data for Span with same name.
+   */
+  struct SSpanData
+  {
+    Stopwatch::timestamp_t total;
+    Stopwatch::timestamp_t active;
+    uint64_t num_spans;
+    uint64_t suspensions;
+  };
+  typedef std::map< SLockData*, std::string > lock_map;
 
-#ifdef _OPENMP
-  omp_lock_t globalLock;
+  static const size_t MAX_ACTIVE = 32;    // tracked nested budgeted scopes
+  static const size_t NAME_LENGTH = 48;   // including the terminating 0
+  static const size_t SLOW_LOG_SIZE = 64; // kept scopes over budget
+  static const size_t MAX_PUBLISHED = 64; // scopes per thread in the signal dump
+  static const uint64_t NOT_PUBLISHED = ~( uint64_t ) 0;
+  static const size_t SEQLOCK_ATTEMPTS = 1000; // of a reader, before it gives up
+
+  /**
+   * A running ScopeTimer with a budget.
+   */
+  struct SActiveScope
+  {
+    char name[ NAME_LENGTH ];
+    Stopwatch::timestamp_t begin;
+    Stopwatch::timestamp_t budget;
+  };
+
+  /**
+   * The running ScopeTimer with a budget of a thread, published with a
+   * sequence number.
+   */
+  struct SActiveStack
+  {
+    uint64_t seq; // odd while written
+    uint64_t depth;
+    SActiveScope scopes[ MAX_ACTIVE ];
+  };
+
+  /**
+   * Calls and time of a scope, published with a sequence number.
+   */
+  struct SPublishedScope
+  {
+    uint64_t seq; // odd while written
+    uint64_t calls;
+    uint64_t time; // in microsec.
+    char name[ NAME_LENGTH ];
+  };
+
+  /**
+   * The published scopes of a thread; entries are only appended.
+   */
+  struct SPublished
+  {
+    uint64_t used;
+    SPublishedScope scopes[ MAX_PUBLISHED ];
+  };
+
+  /**
+   * A ScopeTimer, that exceeded its budget.
+   */
+  struct SSlowScope
+  {
+    char name[ NAME_LENGTH ];
+    double time;
+    double budget;
+  };
+
+  /**
+   * The data of one thread, in local memory of the thread and on
+   * cache lines of its own; see thread_data().
+   */
+  struct SThreadData
+  {
+    ThreadLock lock;     // of timing_data
+    detail::Arena arena; // of the nodes of timing_data
+    mapping timing_data;
+    uint64_t created; // ScopeTimer created on this thread
+    SActiveStack active;
+    SPublished published;
+    SSlowScope slow_log[ SLOW_LOG_SIZE ]; // ring buffer, written by the thread only
+    uint64_t slow_count;                  // scopes over budget
+    bool fork_locked;                     // lock is held for fork()
+
+    SThreadData()
+      : lock()
+      , arena()
+      , timing_data( std::less< std::string >(), allocator( &arena ) )
+      , created( 0 )
+      , active()
+      , published()
+      , slow_log()
+      , slow_count( 0 )
+      , fork_locked( false )
+    {
+    }
+  };
+
+  detail::SlotTable< SThreadData >* _thread_data; // per thread, created on first use
+  std::map< std::string, SSpanData > _spans;
+  lock_map _locks; // of the existing TimedMutex, with their names
+  std::map< std::string, SLockData > _lock_totals; // of destroyed TimedMutex
+#ifdef HAVE_PTHREAD
+  pthread_t _watchdog;
+  int _watchdog_running;
+  double _watchdog_interval;
 #endif
+  int _dumping; // a signal handler writes a dump
+  Stopwatch _sw_overall;
+  double _overhead;       // of a start/stop pair in sec.
+  double _scope_overhead; // of a nested ScopeTimer in sec.
+
+  ThreadLock globalLock; // of the data shared by all threads
 
   // C++ 03
   // ========
@@ -90,85 +522,1122 @@ private:
   ScopeTimeCollector( ScopeTimeCollector const& ); // Don't Implement
   void operator=( ScopeTimeCollector const& );     // Don't implement
 
-public:
-  ScopeTimeCollector()
+  /**
+   * Returns the median cost of a complete ScopeTimer (string copy,
+   * start/stop pair and registering) in seconds.
+   */
+  double
+  calibrate_scope_overhead()
   {
-#ifdef _OPENMP
-    _threads = omp_get_max_threads();
-    omp_init_lock( &globalLock );
-#else
-    _threads = 1;
-#endif
-    _timing_data = new mapping[ _threads ];
-    _sw_overall.start();
+    const size_t batches = 51;
+    const size_t scopes = 100;
+    const std::string name( "calibration" );
+    std::vector< double > per_scope( batches );
+    ThreadLock lock;
+    detail::Arena arena;
+    std::less< std::string > less;
+    mapping scratch( less, allocator( &arena ) );
+
+    for ( size_t b = 0; b < batches; ++b )
+    {
+      Stopwatch::timestamp_t begin = Stopwatch::get_timestamp();
+      for ( size_t i = 0; i < scopes; ++i )
+      {
+        std::string n( name );
+        Stopwatch sw;
+        sw.start();
+        sw.stop();
+        lock.lock();
+        scratch[ n ] = scratch[ n ].update( sw.elapsed( Stopwatch::SECONDS ) );
+        lock.unlock();
+      }
+      per_scope[ b ] = 1.0 * ( Stopwatch::get_timestamp() - begin ) / scopes / Stopwatch::SECONDS;
+    }
+    std::nth_element( per_scope.begin(), per_scope.begin() + batches / 2, per_scope.end() );
+    return per_scope[ batches / 2 ];
   }
 
-  ~ScopeTimeCollector()
+  /**
+   * Returns the slot of the calling thread; each thread has its own,
+   * be it an OpenMP thread, a pthread or a std::thread.
+   */
+  static uint64_t
+  current_thread()
   {
-    mapping::iterator it;
-    // foreach thread
-    for ( size_t i = 0; i < _threads; i++ )
+    return detail::thread_slot();
+  }
+
+  /**
+   * Returns the data of the calling thread. It is created by the
+   * thread itself, such that its memory is local to the thread.
+   */
+  SThreadData&
+  thread_data()
+  {
+    SThreadData** entry = _thread_data->entry( current_thread() );
+    SThreadData* data = __atomic_load_n( entry, __ATOMIC_ACQUIRE );
+    if ( data == 0 )
     {
-      // if thread contains data
-      if ( _timing_data[ i ].size() > 0 )
+      // only this thread writes its slot; readers see 0 or the data
+      data = detail::local_new< SThreadData >();
+      __atomic_store_n( entry, data, __ATOMIC_RELEASE );
+    }
+    return *data;
+  }
+
+  /**
+   * Returns the data of 'thread', or 0, if it has none yet.
+   */
+  SThreadData*
+  thread_data( uint64_t thread ) const
+  {
+    return _thread_data->get( thread );
+  }
+
+  /**
+   * Copies the active scopes of 'stack' consistently into 'scopes'
+   * and returns their number; 0, if no consistent copy succeeded.
+   */
+  static size_t
+  snapshot( const SActiveStack& stack, SActiveScope* scopes )
+  {
+    for ( size_t attempt = 0; attempt < SEQLOCK_ATTEMPTS; ++attempt )
+    {
+      uint64_t seq = __atomic_load_n( &stack.seq, __ATOMIC_ACQUIRE );
+      if ( seq & 1 )
       {
-        std::cerr << std::endl << "\nCollected Timers for thread ";
-        std::cerr << std::setw( 2 ) << i << std::endl;
-        // output all timing data
-        for ( it = _timing_data[ i ].begin(); it != _timing_data[ i ].end(); ++it )
-        {
-          std::cerr << std::setw( 30 ) << it->first.c_str() << " (calls " << std::setw( 4 )
-                    << it->second.num_calls << ") :: " << std::setw( 18 ) << it->second.time
-                    << " sec." << std::endl;
-        }
+        continue; // being written
+      }
+      size_t depth = std::min( ( size_t ) __atomic_load_n( &stack.depth, __ATOMIC_RELAXED ), MAX_ACTIVE );
+      std::memcpy( scopes, stack.scopes, depth * sizeof( SActiveScope ) );
+      __atomic_thread_fence( __ATOMIC_ACQUIRE );
+      if ( __atomic_load_n( &stack.seq, __ATOMIC_RELAXED ) == seq )
+      {
+        return depth;
       }
     }
-    delete[] _timing_data;
-#ifdef _OPENMP
-    omp_destroy_lock( &globalLock );
-#endif
-    _sw_overall.stop();
-    _sw_overall.print( "Complete execution took " );
+    return 0;
   }
 
   /**
-   * Register/ add a measurement of a certain name.
+   * Publishes the calls and time of 'data' of the scope 'name' in
+   * 'published' of the calling thread.
    */
-  void
-  add( const std::string& name, double time )
+  static void
+  publish( SPublished& published, const std::string& name, SScopeData& data )
   {
-#ifdef _OPENMP
-    omp_set_lock( &globalLock );
-    uint64_t tid = omp_get_thread_num();
-    _timing_data[ tid ][ name ] = _timing_data[ tid ][ name ].update( time );
-    omp_unset_lock( &globalLock );
-#else
-    _timing_data[ 0 ][ name ] = _timing_data[ 0 ][ name ].update( time );
-#endif
+    if ( data.published == 0 )
+    {
+      uint64_t used = published.used;
+      if ( used == MAX_PUBLISHED )
+      {
+        data.published = NOT_PUBLISHED;
+        return;
+      }
+      SPublishedScope& scope = published.scopes[ used ];
+      size_t length = std::min( name.size(), NAME_LENGTH - 1 );
+      std::memcpy( scope.name, name.data(), length );
+      scope.name[ length ] = 0;
+      data.published = used + 1;
+      __atomic_store_n( &published.used, used + 1, __ATOMIC_RELEASE );
+    }
+    else if ( data.published == NOT_PUBLISHED )
+    {
+      return;
+    }
+    SPublishedScope& scope = published.scopes[ data.published - 1 ];
+    __atomic_store_n( &scope.seq, scope.seq + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    __atomic_store_n( &scope.calls, data.num_calls, __ATOMIC_RELAXED );
+    __atomic_store_n(
+      &scope.time, ( uint64_t )( data.time * Stopwatch::SECONDS + 0.5 ), __ATOMIC_RELAXED );
+    __atomic_store_n( &scope.seq, scope.seq + 1, __ATOMIC_RELEASE );
   }
-};
-/** global instance of the ScopeTimeCollector **/
-ScopeTimeCollector scopetimecollector;
-#endif /* #if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER ) */
-}
 
-#if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER )
-timer::ScopeTimer::ScopeTimer( const std::string& name )
-  : _name( name )
-  , _stopwatch()
-{
-  _stopwatch.start();
-}
-#else
-timer::ScopeTimer::ScopeTimer( const std::string& )
-{
-}
+#ifdef HAVE_PTHREAD
+  /**
+   * Body of the watchdog thread: reports each scope over budget once.
+   */
+  static void*
+  watchdog_main( void* arg )
+  {
+    ScopeTimeCollector* self = static_cast< ScopeTimeCollector* >( arg );
+    std::vector< SActiveScope > scopes( MAX_ACTIVE );
+    // begin of the reported scope per thread and depth
+    std::vector< Stopwatch::timestamp_t > reported;
+    struct timespec interval;
+    interval.tv_sec = ( time_t ) self->_watchdog_interval;
+    interval.tv_nsec = ( long ) ( ( self->_watchdog_interval - interval.tv_sec ) * 1e9 );
+
+    while ( __atomic_load_n( &self->_watchdog_running, __ATOMIC_ACQUIRE ) )
+    {
+      nanosleep( &interval, 0 );
+      Stopwatch::timestamp_t now = Stopwatch::get_timestamp();
+      uint64_t threads = self->_thread_data->size();
+      reported.resize( threads * MAX_ACTIVE, 0 ); // the slots may have grown
+      for ( uint64_t t = 0; t < threads; ++t )
+      {
+        const SThreadData* data = self->thread_data( t );
+        size_t depth = data != 0 ? snapshot( data->active, &scopes[ 0 ] ) : 0;
+        for ( size_t i = 0; i < depth; ++i )
+        {
+          Stopwatch::timestamp_t elapsed = now > scopes[ i ].begin ? now - scopes[ i ].begin : 0;
+          if ( elapsed > scopes[ i ].budget && reported[ t * MAX_ACTIVE + i ] != scopes[ i ].begin )
+          {
+            reported[ t * MAX_ACTIVE + i ] = scopes[ i ].begin;
+            std::cerr << "Watchdog: " << scopes[ i ].name << " (thread " << std::setw( 2 ) << t
+                      << ") open for " << 1.0 * elapsed / Stopwatch::SECONDS << " sec. (budget "
+                      << 1.0 * scopes[ i ].budget / Stopwatch::SECONDS << " sec.)" << std::endl;
+          }
+        }
+      }
+    }
+    return 0;
+  }
 #endif
 
-timer::ScopeTimer::~ScopeTimer()
-{
+  /**
+   * Outputs the scopes over budget, that are kept in the slow log.
+   */
+  void
+  report_slow_log() const
+  {
+    uint64_t count = 0;
+    size_t kept = 0;
+    for ( uint64_t t = 0; t < _thread_data->size(); ++t )
+    {
+      const SThreadData* data = thread_data( t );
+      if ( data != 0 )
+      {
+        count += data->slow_count;
+        kept += std::min( ( size_t ) data->slow_count, SLOW_LOG_SIZE );
+      }
+    }
+    if ( count == 0 )
+    {
+      return;
+    }
+    std::cerr << std::endl
+              << "\nSlow scopes (last " << kept << " of " << count << " over budget)" << std::endl;
+    for ( uint64_t t = 0; t < _thread_data->size(); ++t )
+    {
+      const SThreadData* data = thread_data( t );
+      size_t thread_kept = data != 0 ? std::min( ( size_t ) data->slow_count, SLOW_LOG_SIZE ) : 0;
+      for ( size_t i = 0; i < thread_kept; ++i )
+      {
+        const SSlowScope& slow
+          = data->slow_log[ ( data->slow_count - thread_kept + i ) % SLOW_LOG_SIZE ];
+        std::cerr << std::setw( 30 ) << slow.name << " (thread " << std::setw( 2 ) << t
+                  << ") :: " << std::setw( 18 ) << slow.time << " sec. (budget " << slow.budget
+                  << " sec.)" << std::endl;
+      }
+    }
+  }
+
+  /**
+   * Outputs the accumulated times of the Span.
+   */
+  void
+  report_spans() const
+  {
+    if ( _spans.empty() )
+    {
+      return;
+    }
+    std::cerr << std::endl << "\nCollected Spans" << std::endl;
+    for ( std::map< std::string, SSpanData >::const_iterator it = _spans.begin();
+          it != _spans.end();
+          ++it )
+    {
+      std::cerr << std::setw( 30 ) << it->first.c_str() << " (spans " << std::setw( 4 )
+                << it->second.num_spans << ", suspensions " << std::setw( 4 )
+                << it->second.suspensions << ") :: total "
+                << 1.0 * it->second.total / Stopwatch::SECONDS << " sec., active "
+                << 1.0 * it->second.active / Stopwatch::SECONDS << " sec., suspended "
+                << 1.0 * ( it->second.total - it->second.active ) / Stopwatch::SECONDS << " sec."
+                << std::endl;
+    }
+  }
+
+  /**
+   * Adds the statistics 'data' to 'sum'.
+   */
+  static void
+  add_lock_data( SLockData& sum, const SLockData& data )
+  {
+    sum.acquisitions += data.acquisitions;
+    sum.contended += data.contended;
+    sum.wait_time += data.wait_time;
+    sum.max_wait = std::max( sum.max_wait, data.max_wait );
+    sum.hold_time += data.hold_time;
+    sum.cv_waits += data.cv_waits;
+    sum.cv_wait_time += data.cv_wait_time;
+  }
+
+  /**
+   * Outputs the statistics of the TimedMutex with the same name summed
+   * up, with the largest total wait time first.
+   */
+  void
+  report_locks() const
+  {
+    if ( _locks.empty() && _lock_totals.empty() )
+    {
+      return;
+    }
+    std::map< std::string, SLockData > by_name = _lock_totals;
+    for ( lock_map::const_iterator it = _locks.begin(); it != _locks.end(); ++it )
+    {
+      add_lock_data( by_name[ it->second ], *it->first );
+    }
+    std::vector< std::pair< uint64_t, std::string > > ranked;
+    for ( std::map< std::string, SLockData >::const_iterator it = by_name.begin();
+          it != by_name.end();
+          ++it )
+    {
+      ranked.push_back( std::make_pair( it->second.wait_time, it->first ) );
+    }
+    std::sort( ranked.rbegin(), ranked.rend() );
+
+    std::cerr << std::endl << "\nLock contention (ranked by wait time)" << std::endl;
+    for ( size_t i = 0; i < ranked.size(); ++i )
+    {
+      const SLockData& data = by_name[ ranked[ i ].second ];
+      double contended
+        = data.acquisitions > 0 ? 100.0 * data.contended / data.acquisitions : 0.0;
+      std::cerr << std::setw( 30 ) << ranked[ i ].second.c_str() << " (acquired "
+                << std::setw( 6 ) << data.acquisitions << ", contended " << std::setw( 5 )
+                << contended << "%) :: wait " << 1.0 * data.wait_time / Stopwatch::SECONDS
+                << " sec. (max " << 1.0 * data.max_wait / Stopwatch::SECONDS << "), hold "
+                << 1.0 * data.hold_time / Stopwatch::SECONDS << " sec. when contended";
+      if ( data.cv_waits > 0 )
+      {
+        std::cerr << ", condition waits " << data.cv_waits << " :: "
+                  << 1.0 * data.cv_wait_time / Stopwatch::SECONDS << " sec.";
+      }
+      std::cerr << std::endl;
+    }
+  }
+
+public:
+  ScopeTimeCollector()
+  {
+    _thread_data = new detail::SlotTable< SThreadData >();
+#ifdef HAVE_PTHREAD
+    _watchdog_running = 0;
+    _watchdog_interval = 0.0;
+    pthread_atfork( &fork_prepare, &fork_parent, &fork_child );
+#endif
+    _dumping = 0;
+    _overhead = Stopwatch::overhead() / Stopwatch::SECONDS;
+    _scope_overhead = calibrate_scope_overhead();
+    _sw_overall.start();
+  }
+
+  ~ScopeTimeCollector()
+  {
+    remove_signal_dump();
+    stop_metrics_server();
+    stop_watchdog();
+    mapping::iterator it;
+    // foreach thread
+    for ( size_t i = 0; i < _thread_data->size(); i++ )
+    {
+      // if thread contains data
+      if ( _thread_data->get( i ) != 0 && _thread_data->get( i )->timing_data.size() > 0 )
+      {
+        mapping& timing_data = _thread_data->get( i )->timing_data;
+        std::cerr << std::endl << "\nCollected Timers for thread ";
+        std::cerr << std::setw( 2 ) << i << std::endl;
+        // output all timing data
+        for ( it = timing_data.begin(); it != timing_data.end(); ++it )
+        {
+          std::cerr << std::setw( 30 ) << it->first.c_str() << " (calls " << std::setw( 4 )
+                    << it->second.num_calls << ") :: " << std::setw( 18 ) << it->second.time
+                    << " sec." << std::endl;
+          if ( it->second.cpu_calls > 0 )
+          {
+            double utilization = it->second.cpu_wall_time > 0.0
+              ? 100.0 * it->second.cpu_time / it->second.cpu_wall_time
+              : 0.0;
+            std::cerr << std::setw( 32 ) << ""
+                      << "cpu " << it->second.cpu_time << " sec. (" << utilization
+                      << "% utilization)" << std::endl;
+#ifdef HAVE_RUSAGE_THREAD
+            std::cerr << std::setw( 32 ) << ""
+                      << "context switches " << it->second.voluntary << " voluntary, "
+                      << it->second.involuntary << " involuntary" << std::endl;
+#endif
+          }
+        }
+      }
+    }
+    report_slow_log();
+    report_spans();
+    report_locks();
+    std::cerr << std::endl
+              << "Timer overhead: " << _overhead * Stopwatch::SECONDS << " microsec. per measurement, "
+              << _scope_overhead * Stopwatch::SECONDS << " microsec. per nested ScopeTimer"
+#ifdef ENABLE_OVERHEAD_COMPENSATION
+              << " (subtracted)"
+#endif
+              << ", clock resolution: " << Stopwatch::resolution() << " microsec." << std::endl;
+    for ( size_t i = 0; i < _thread_data->size(); i++ )
+    {
+      detail::local_delete( _thread_data->get( i ) );
+    }
+    delete _thread_data;
+    _thread_data = 0; // for fork() and TimedMutex during the remaining exit
+    _sw_overall.stop();
+    _sw_overall.print( "Complete execution took " );
+  }
+
+  /**
+   * Counts a new ScopeTimer on the calling thread and returns the
+   * number of ScopeTimer created on it before.
+   */
+  uint64_t
+  enter()
+  {
+    return thread_data().created++;
+  }
+
+  /**
+   * Returns 'time' of a ScopeTimer without the overhead of its own
+   * measurement and of the ScopeTimer created in its scope.
+   */
+  double
+  compensate( double time, uint64_t created )
+  {
+    uint64_t nested = thread_data().created - created - 1;
+    double result = time - _overhead - nested * _scope_overhead;
+    return result > 0.0 ? result : 0.0;
+  }
+
+  /**
+   * Register/ add a measurement of a certain name.
+   */
+  void
+  add( const std::string& name, double time )
+  {
+    SThreadData& data = thread_data();
+    data.lock.lock();
+    SScopeData& scope = data.timing_data[ name ];
+    scope.update( time );
+    publish( data.published, name, scope );
+    data.lock.unlock();
+  }
+
+  /**
+   * Publishes a ScopeTimer with a budget, that began at 'begin', on
+   * the stack of the calling thread.
+   */
+  void
+  push( const std::string& name, Stopwatch::timestamp_t begin, Stopwatch::timestamp_t budget )
+  {
+    SActiveStack& stack = thread_data().active;
+    uint64_t depth = stack.depth;
+    __atomic_store_n( &stack.seq, stack.seq + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    if ( depth < MAX_ACTIVE )
+    {
+      SActiveScope& scope = stack.scopes[ depth ];
+      size_t length = std::min( name.size(), NAME_LENGTH - 1 );
+      std::memcpy( scope.name, name.data(), length );
+      scope.name[ length ] = 0;
+      scope.begin = begin;
+      scope.budget = budget;
+    }
+    __atomic_store_n( &stack.depth, depth + 1, __ATOMIC_RELAXED );
+    __atomic_store_n( &stack.seq, stack.seq + 1, __ATOMIC_RELEASE );
+  }
+
+  /**
+   * Removes the innermost ScopeTimer with a budget of the calling
+   * thread, and keeps it in the slow log of the thread, if 'time'
+   * (sec.) exceeds its 'budget' (sec.).
+   */
+  void
+  pop( const std::string& name, double time, double budget )
+  {
+    SThreadData& data = thread_data();
+    SActiveStack& stack = data.active;
+    __atomic_store_n( &stack.seq, stack.seq + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    __atomic_store_n( &stack.depth, stack.depth - 1, __ATOMIC_RELAXED );
+    __atomic_store_n( &stack.seq, stack.seq + 1, __ATOMIC_RELEASE );
+
+    if ( time > budget )
+    {
+      SSlowScope& slow = data.slow_log[ data.slow_count++ % SLOW_LOG_SIZE ];
+      size_t length = std::min( name.size(), NAME_LENGTH - 1 );
+      std::memcpy( slow.name, name.data(), length );
+      slow.name[ length ] = 0;
+      slow.time = time;
+      slow.budget = budget;
+    }
+  }
+
+  /**
+   * Starts the watchdog thread; see timer::start_watchdog().
+   */
+  bool
+  start_watchdog( double interval )
+  {
+#ifdef HAVE_PTHREAD
+    if ( _watchdog_running )
+    {
+      return false;
+    }
+    _watchdog_interval = interval;
+    __atomic_store_n( &_watchdog_running, 1, __ATOMIC_RELEASE );
+    if ( pthread_create( &_watchdog, 0, &ScopeTimeCollector::watchdog_main, this ) != 0 )
+    {
+      _watchdog_running = 0;
+      return false;
+    }
+    return true;
+#else
+    ( void ) interval;
+    return false;
+#endif
+  }
+
+  /**
+   * Stops the watchdog thread, if running.
+   */
+  void
+  stop_watchdog()
+  {
+#ifdef HAVE_PTHREAD
+    if ( _watchdog_running )
+    {
+      __atomic_store_n( &_watchdog_running, 0, __ATOMIC_RELEASE );
+      pthread_join( _watchdog, 0 );
+    }
+#endif
+  }
+
+  /**
+   * Adds a finished span of a certain name.
+   */
+  void
+  add_span( const std::string& name,
+    Stopwatch::timestamp_t total,
+    Stopwatch::timestamp_t active,
+    uint64_t suspensions )
+  {
+    globalLock.lock();
+    SSpanData& data = _spans[ name ];
+    data.total += total;
+    data.active += active;
+    ++data.num_spans;
+    data.suspensions += suspensions;
+    globalLock.unlock();
+  }
+
+  /**
+   * Returns new, zeroed statistics for a TimedMutex named 'name'.
+   */
+  SLockData*
+  register_lock( const std::string& name )
+  {
+    SLockData zero = { 0, 0, 0, 0, 0, 0, 0 };
+    SLockData* result = new SLockData( zero );
+    globalLock.lock();
+    _locks[ result ] = name;
+    globalLock.unlock();
+    return result;
+  }
+
+  /**
+   * Adds the statistics of a destroyed TimedMutex to the total of its
+   * name and releases them.
+   */
+  void
+  unregister_lock( SLockData* data )
+  {
+    if ( _thread_data == 0 )
+    {
+      return; // reported already; the statistics stay valid until exit
+    }
+    globalLock.lock();
+    lock_map::iterator it = _locks.find( data );
+    if ( it != _locks.end() )
+    {
+      add_lock_data( _lock_totals[ it->second ], *data );
+      _locks.erase( it );
+    }
+    globalLock.unlock();
+    delete data;
+  }
+
+  /**
+   * Register/ add a measurement of a certain name with the cpu time
+   * and context switches during it.
+   */
+  void
+  add( const std::string& name,
+    double time,
+    double cpu_time,
+    uint64_t voluntary,
+    uint64_t involuntary )
+  {
+    SThreadData& data = thread_data();
+    data.lock.lock();
+    SScopeData& scope = data.timing_data[ name ];
+    scope.update( time, cpu_time, voluntary, involuntary );
+    publish( data.published, name, scope );
+    data.lock.unlock();
+  }
+
+  enum EFamily
+  {
+    CALLS,
+    SECONDS,
+    CPU_SECONDS
+  };
+
+  /**
+   * Appends the samples of 'family' of all threads to 'buffer'.
+   */
+  void
+  render_samples( std::string& buffer, EFamily family ) const
+  {
+    for ( uint64_t t = 0; t < _thread_data->size(); ++t )
+    {
+      SThreadData* data = thread_data( t );
+      if ( data == 0 )
+      {
+        continue;
+      }
+      data->lock.lock();
+      for ( mapping::const_iterator it = data->timing_data.begin();
+            it != data->timing_data.end();
+            ++it )
+      {
+        append_samples( buffer, family, it->first, t, it->second );
+      }
+      data->lock.unlock();
+    }
+  }
+
+  /**
+   * Appends the samples of 'family' of the scope 'name' of 'thread'
+   * to 'buffer'.
+   */
+  static void
+  append_samples( std::string& buffer,
+    EFamily family,
+    const std::string& name,
+    uint64_t thread,
+    const SScopeData& data )
+  {
+    switch ( family )
+    {
+      case CALLS:
+        buffer += "timer_scope_calls_total";
+        append_labels( buffer, name, thread );
+        buffer += "} ";
+        append_number( buffer, data.num_calls );
+        buffer += "\n";
+        break;
+      case SECONDS:
+      {
+        uint64_t cumulative = 0;
+        double limit = 1.0 / Stopwatch::SECONDS;
+        for ( size_t b = 0; b < BUCKETS; ++b, limit *= 4.0 )
+        {
+          cumulative += data.buckets[ b ];
+          buffer += "timer_scope_seconds_bucket";
+          append_labels( buffer, name, thread );
+          buffer += ",le=\"";
+          if ( b < BUCKETS - 1 )
+          {
+            append_number( buffer, limit );
+          }
+          else
+          {
+            buffer += "+Inf";
+          }
+          buffer += "\"} ";
+          append_number( buffer, cumulative );
+          buffer += "\n";
+        }
+        buffer += "timer_scope_seconds_sum";
+        append_labels( buffer, name, thread );
+        buffer += "} ";
+        append_number( buffer, data.time );
+        buffer += "\ntimer_scope_seconds_count";
+        append_labels( buffer, name, thread );
+        buffer += "} ";
+        append_number( buffer, data.num_calls );
+        buffer += "\n";
+        break;
+      }
+      case CPU_SECONDS:
+        if ( data.cpu_calls > 0 )
+        {
+          buffer += "timer_scope_cpu_seconds_total";
+          append_labels( buffer, name, thread );
+          buffer += "} ";
+          append_number( buffer, data.cpu_time );
+          buffer += "\n";
+        }
+        break;
+    }
+  }
+
+  /**
+   * Renders the accumulated times; see timer::render_openmetrics().
+   */
+  void
+  render_openmetrics( std::string& buffer ) const
+  {
+    // the samples of a metric family have to be consecutive, hence one
+    // pass over the threads per family; each thread is locked while its
+    // samples are appended, without copying its data
+    buffer.clear();
+    buffer += "# TYPE timer_scope_calls counter\n"
+              "# HELP timer_scope_calls Completed ScopeTimer.\n";
+    render_samples( buffer, CALLS );
+    buffer += "# TYPE timer_scope_seconds histogram\n"
+              "# UNIT timer_scope_seconds seconds\n"
+              "# HELP timer_scope_seconds Durations of the ScopeTimer.\n";
+    render_samples( buffer, SECONDS );
+    buffer += "# TYPE timer_scope_cpu_seconds counter\n"
+              "# UNIT timer_scope_cpu_seconds seconds\n"
+              "# HELP timer_scope_cpu_seconds Cpu time of the ScopeTimer with CPUTIME.\n";
+    render_samples( buffer, CPU_SECONDS );
+    buffer += "# EOF\n";
+  }
+
+#ifdef HAVE_SIGACTION
+  /**
+   * Writes the published scopes and the active scopes of all threads
+   * to 'fd'; async-signal-safe. Concurrent calls write nothing.
+   */
+  void
+  dump( int fd )
+  {
+    if ( __atomic_exchange_n( &_dumping, 1, __ATOMIC_ACQUIRE ) || _thread_data == 0 )
+    {
+      return;
+    }
+    SignalWriter out( fd );
+    out.put( "\nTimer dump (pid " );
+    out.put( ( uint64_t ) getpid() );
+    out.put( ")\n" );
+    struct timespec ts;
+    clock_gettime( CLOCK_REALTIME, &ts ); // the clock of gettimeofday()
+    Stopwatch::timestamp_t now = ts.tv_sec * Stopwatch::SECONDS + ts.tv_nsec / 1000;
+    SActiveScope scopes[ MAX_ACTIVE ];
+    for ( uint64_t t = 0; t < _thread_data->size(); ++t )
+    {
+      const SThreadData* data = thread_data( t );
+      if ( data == 0 )
+      {
+        continue;
+      }
+      const SPublished& published = data->published;
+      size_t used = std::min( ( size_t ) __atomic_load_n( &published.used, __ATOMIC_ACQUIRE ),
+        MAX_PUBLISHED );
+      for ( size_t i = 0; i < used; ++i )
+      {
+        const SPublishedScope& scope = published.scopes[ i ];
+        uint64_t calls = 0;
+        uint64_t time = 0;
+        bool consistent = false;
+        for ( size_t attempt = 0; attempt < SEQLOCK_ATTEMPTS && not consistent; ++attempt )
+        {
+          uint64_t seq = __atomic_load_n( &scope.seq, __ATOMIC_ACQUIRE );
+          calls = __atomic_load_n( &scope.calls, __ATOMIC_RELAXED );
+          time = __atomic_load_n( &scope.time, __ATOMIC_RELAXED );
+          __atomic_thread_fence( __ATOMIC_ACQUIRE );
+          consistent = ( seq & 1 ) == 0 && __atomic_load_n( &scope.seq, __ATOMIC_RELAXED ) == seq;
+        }
+        out.put( scope.name );
+        out.put( " (thread " );
+        out.put( t );
+        if ( consistent )
+        {
+          out.put( ") calls " );
+          out.put( calls );
+          out.put( " :: " );
+          out.put( time );
+          out.put( " microsec.\n" );
+        }
+        else
+        {
+          out.put( ") being updated\n" );
+        }
+      }
+      size_t depth = snapshot( data->active, scopes );
+      for ( size_t i = 0; i < depth; ++i )
+      {
+        out.put( "open: " );
+        out.put( scopes[ i ].name );
+        out.put( " (thread " );
+        out.put( t );
+        out.put( ") for " );
+        out.put( now > scopes[ i ].begin ? now - scopes[ i ].begin : 0 );
+        out.put( " microsec. (budget " );
+        out.put( scopes[ i ].budget );
+        out.put( " microsec.)\n" );
+      }
+    }
+    out.flush();
+    __atomic_store_n( &_dumping, 0, __ATOMIC_RELEASE );
+  }
+#endif
+
+#ifdef HAVE_PTHREAD
+  /**
+   * Holds all locks, such that a child of fork() inherits consistent
+   * data; see fork_parent() and fork_child().
+   */
+  void
+  before_fork()
+  {
+    if ( _thread_data == 0 )
+    {
+      return;
+    }
+    globalLock.lock();
+    for ( uint64_t t = 0; t < _thread_data->size(); ++t )
+    {
+      SThreadData* data = thread_data( t );
+      if ( data != 0 )
+      {
+        data->lock.lock();
+        data->fork_locked = true;
+      }
+    }
+  }
+
+  /**
+   * Releases the locks of before_fork() in the parent.
+   */
+  void
+  after_fork_parent()
+  {
+    if ( _thread_data == 0 )
+    {
+      return;
+    }
+    for ( uint64_t t = 0; t < _thread_data->size(); ++t )
+    {
+      SThreadData* data = thread_data( t );
+      if ( data != 0 && data->fork_locked )
+      {
+        data->fork_locked = false;
+        data->lock.unlock();
+      }
+    }
+    globalLock.unlock();
+  }
+
+  /**
+   * Initializes the locks again in the child, and discards the data
+   * of the parent: only the forking thread exists in the child, hence
+   * only its active scopes remain.
+   */
+  void
+  after_fork_child()
+  {
+    if ( _thread_data == 0 )
+    {
+      return;
+    }
+    globalLock.reinit();
+    uint64_t self = current_thread();
+    for ( uint64_t t = 0; t < _thread_data->size(); ++t )
+    {
+      SThreadData* data = thread_data( t );
+      if ( data == 0 )
+      {
+        continue;
+      }
+      data->lock.reinit();
+      data->fork_locked = false;
+      data->timing_data.clear(); // the nodes stay in the arena
+      data->published.used = 0;
+      data->slow_count = 0;
+      if ( t != self )
+      {
+        data->active.seq = 0;
+        data->active.depth = 0;
+      }
+    }
+    _spans.clear();
+    SLockData zero = { 0, 0, 0, 0, 0, 0, 0 };
+    for ( lock_map::iterator it = _locks.begin(); it != _locks.end(); ++it )
+    {
+      *it->first = zero; // still referenced by the TimedMutex
+    }
+    _lock_totals.clear();
+    _watchdog_running = 0;
+    _sw_overall.reset();
+    _sw_overall.start();
+  }
+#endif
+};
+const size_t ScopeTimeCollector::BUCKETS;
+const size_t ScopeTimeCollector::MAX_ACTIVE;
+const size_t ScopeTimeCollector::NAME_LENGTH;
+const size_t ScopeTimeCollector::SLOW_LOG_SIZE;
+const size_t ScopeTimeCollector::MAX_PUBLISHED;
+const uint64_t ScopeTimeCollector::NOT_PUBLISHED;
+const size_t ScopeTimeCollector::SEQLOCK_ATTEMPTS;
+
+/** global instance of the ScopeTimeCollector **/
+ScopeTimeCollector scopetimecollector;
+
+namespace
+{
+#ifdef HAVE_PTHREAD
+void
+fork_prepare()
+{
+  scopetimecollector.before_fork();
+}
+
+void
+fork_parent()
+{
+  scopetimecollector.after_fork_parent();
+}
+
+void
+fork_child()
+{
+  scopetimecollector.after_fork_child();
+}
+#endif
+
+#ifdef HAVE_SIGACTION
+int dump_signal = 0; // with the handler installed
+int dump_fd = -1;
+struct sigaction previous_action;
+
+void
+dump_handler( int )
+{
+  int saved = errno;
+  scopetimecollector.dump( dump_fd );
+  errno = saved;
+}
+#endif
+}
+
+void
+detail::add_span( const std::string& name,
+  Stopwatch::timestamp_t total,
+  Stopwatch::timestamp_t active,
+  uint64_t suspensions )
+{
+  scopetimecollector.add_span( name, total, active, suspensions );
+}
+
+SLockData*
+detail::register_lock( const std::string& name )
+{
+  return scopetimecollector.register_lock( name );
+}
+
+void
+detail::unregister_lock( SLockData* data )
+{
+  scopetimecollector.unregister_lock( data );
+}
+
+bool
+start_watchdog( double interval )
+{
+  return scopetimecollector.start_watchdog( interval );
+}
+
+void
+stop_watchdog()
+{
+  scopetimecollector.stop_watchdog();
+}
+
+void
+render_openmetrics( std::string& buffer )
+{
+  scopetimecollector.render_openmetrics( buffer );
+}
+
+bool
+install_signal_dump( int signum, int fd )
+{
+#ifdef HAVE_SIGACTION
+  if ( dump_signal != 0 )
+  {
+    return false;
+  }
+  struct sigaction action;
+  std::memset( &action, 0, sizeof( action ) );
+  action.sa_handler = &dump_handler;
+  sigemptyset( &action.sa_mask );
+  action.sa_flags = SA_RESTART;
+  dump_fd = fd;
+  if ( sigaction( signum, &action, &previous_action ) != 0 )
+  {
+    return false;
+  }
+  dump_signal = signum;
+  return true;
+#else
+  ( void ) signum;
+  ( void ) fd;
+  return false;
+#endif
+}
+
+void
+remove_signal_dump()
+{
+#ifdef HAVE_SIGACTION
+  if ( dump_signal != 0 )
+  {
+    sigaction( dump_signal, &previous_action, 0 );
+    dump_signal = 0;
+  }
+#endif
+}
+#else
+bool
+start_watchdog( double )
+{
+  return false;
+}
+
+void
+stop_watchdog()
+{
+}
+
+void
+render_openmetrics( std::string& buffer )
+{
+  buffer = "# EOF\n";
+}
+
+bool
+install_signal_dump( int, int )
+{
+  return false;
+}
+
+void
+remove_signal_dump()
+{
+}
+#endif /* #if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER ) */
+}
+
+#if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER )
+void
+timer::ScopeTimer::thread_usage( SUsage& usage )
+{
+#if defined( HAVE_RUSAGE_THREAD )
+  struct rusage ru;
+  getrusage( RUSAGE_THREAD, &ru );
+  usage.cpu_time = ( ru.ru_utime.tv_sec + ru.ru_stime.tv_sec ) * Stopwatch::SECONDS
+    + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+  usage.voluntary = ru.ru_nvcsw;
+  usage.involuntary = ru.ru_nivcsw;
+#elif defined( HAVE_CLOCK_THREAD_CPUTIME_ID )
+  struct timespec ts;
+  clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+  usage.cpu_time = ts.tv_sec * Stopwatch::SECONDS + ts.tv_nsec / 1000;
+  usage.voluntary = 0;
+  usage.involuntary = 0;
+#else
+  usage.cpu_time = 0;
+  usage.voluntary = 0;
+  usage.involuntary = 0;
+#endif
+}
+
+timer::ScopeTimer::ScopeTimer( const std::string& name, flags_t flags )
+  : _name( name )
+  , _flags( flags )
+  , _budget( 0 )
+  , _stopwatch()
+{
+  begin();
+}
+
+timer::ScopeTimer::ScopeTimer( const std::string& name, double budget, flags_t flags )
+  : _name( name )
+  , _flags( flags )
+  , _budget( 0 )
+  , _stopwatch()
+{
+  if ( budget > 0.0 )
+  {
+    // 0 means none, hence a budget below the clock resolution is rounded up
+    _budget = std::max( ( Stopwatch::timestamp_t )( budget * Stopwatch::SECONDS ),
+      ( Stopwatch::timestamp_t ) 1 );
+  }
+  begin();
+}
+
+void
+timer::ScopeTimer::begin()
+{
+#ifdef ENABLE_OVERHEAD_COMPENSATION
+  _created = scopetimecollector.enter();
+#endif
+  if ( _flags & CPUTIME )
+  {
+    thread_usage( _usage );
+  }
+  if ( _budget != 0 )
+  {
+    scopetimecollector.push( _name, Stopwatch::get_timestamp(), _budget );
+  }
+  _stopwatch.start();
+}
+#else
+timer::ScopeTimer::ScopeTimer( const std::string&, flags_t )
+{
+}
+
+timer::ScopeTimer::ScopeTimer( const std::string&, double, flags_t )
+{
+}
+#endif
+
+timer::ScopeTimer::~ScopeTimer()
+{
 #if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER )
   _stopwatch.stop();
-  scopetimecollector.add( _name, _stopwatch.elapsed( Stopwatch::SECONDS ) );
+#ifdef ENABLE_OVERHEAD_COMPENSATION
+  double time = scopetimecollector.compensate( _stopwatch.elapsed( Stopwatch::SECONDS ), _created );
+#else
+  double time = _stopwatch.elapsed( Stopwatch::SECONDS );
+#endif
+  if ( _budget != 0 )
+  {
+    scopetimecollector.pop( _name, time, 1.0 * _budget / Stopwatch::SECONDS );
+  }
+  if ( _flags & CPUTIME )
+  {
+    SUsage usage;
+    thread_usage( usage );
+    scopetimecollector.add( _name,
+      time,
+      1.0 * ( usage.cpu_time - _usage.cpu_time ) / Stopwatch::SECONDS,
+      usage.voluntary - _usage.voluntary,
+      usage.involuntary - _usage.involuntary );
+  }
+  else
+  {
+    scopetimecollector.add( _name, time );
+  }
 #endif
 }
@@ -0,0 +1,281 @@
+/**
+ * seriescomparison.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "seriescomparison.hpp"
+#include "bootstrap.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+namespace timer
+{
+std::ostream&
+operator<<( std::ostream& os, const SeriesComparison& comparison )
+{
+  comparison.print( "", Stopwatch::SECONDS, os );
+  return os;
+}
+
+namespace
+{
+const uint64_t BASELINE_SEED = 0x5eed0001;
+const uint64_t CANDIDATE_SEED = 0x5eed0002;
+
+/**
+ * Returns the shift (candidate - baseline) of the bootstrapped
+ * statistic 'i' of 'stride' statistics per resample.
+ */
+SeriesComparison::SInterval
+shift( const std::vector< double >& baseline,
+  const std::vector< double >& candidate,
+  size_t i,
+  size_t stride,
+  double estimate,
+  double alpha )
+{
+  size_t resamples = baseline.size() / stride;
+  std::vector< double > diff( resamples );
+  for ( size_t r = 0; r < resamples; ++r )
+  {
+    diff[ r ] = candidate[ r * stride + i ] - baseline[ r * stride + i ];
+  }
+  SeriesComparison::SInterval result;
+  result.estimate = estimate;
+  result.low = detail::percentile( diff, alpha / 2 );
+  result.high = detail::percentile( diff, 1.0 - alpha / 2 );
+  return result;
+}
+
+SeriesComparison::SInterval
+scale( SeriesComparison::SInterval interval, Stopwatch::timeunit_t timeunit )
+{
+  interval.estimate /= timeunit;
+  interval.low /= timeunit;
+  interval.high /= timeunit;
+  return interval;
+}
+}
+}
+
+timer::SeriesComparison::SeriesComparison( const SeriesTimer& baseline,
+  const SeriesTimer& candidate,
+  double alpha,
+  size_t resamples )
+  : _baseline_size( baseline.size() )
+  , _candidate_size( candidate.size() )
+  , _alpha( alpha )
+  , _u( 0.0 )
+  , _p_value( 1.0 )
+  , _verdict( NOT_SIGNIFICANT )
+{
+  assert( alpha > 0.0 && alpha < 1.0 );
+  SInterval zero = { 0.0, 0.0, 0.0 };
+  _median = zero;
+  _p99 = zero;
+  if ( _baseline_size == 0 || _candidate_size == 0 )
+  {
+    return;
+  }
+
+  std::vector< Stopwatch::timestamp_t > b;
+  std::vector< Stopwatch::timestamp_t > c;
+#pragma omp parallel sections
+  {
+#pragma omp section
+    {
+      b = baseline.timestamps();
+      std::sort( b.begin(), b.end() );
+    }
+#pragma omp section
+    {
+      c = candidate.timestamps();
+      std::sort( c.begin(), c.end() );
+    }
+  }
+
+  // Mann-Whitney U: rank sum of the candidate in the merged order;
+  // tied values get the average of their ranks
+  const double nb = b.size();
+  const double nc = c.size();
+  const double n = nb + nc;
+  double rank_sum = 0.0;
+  double ties = 0.0;
+  double rank = 1.0;
+  size_t i = 0;
+  size_t j = 0;
+  while ( i < b.size() || j < c.size() )
+  {
+    Stopwatch::timestamp_t v;
+    if ( j == c.size() || ( i < b.size() && b[ i ] < c[ j ] ) )
+    {
+      v = b[ i ];
+    }
+    else
+    {
+      v = c[ j ];
+    }
+    double tb = 0.0;
+    double tc = 0.0;
+    for ( ; i < b.size() && b[ i ] == v; ++i )
+    {
+      ++tb;
+    }
+    for ( ; j < c.size() && c[ j ] == v; ++j )
+    {
+      ++tc;
+    }
+    double t = tb + tc;
+    rank_sum += tc * ( rank + ( t - 1.0 ) / 2.0 );
+    ties += t * t * t - t;
+    rank += t;
+  }
+  _u = rank_sum - nc * ( nc + 1.0 ) / 2.0;
+
+  double mean = nb * nc / 2.0;
+  double variance = nb * nc / 12.0 * ( ( n + 1.0 ) - ties / ( n * ( n - 1.0 ) ) );
+  if ( variance > 0.0 )
+  {
+    // normal approximation with continuity correction
+    double z = std::max( 0.0, std::fabs( _u - mean ) - 0.5 ) / std::sqrt( variance );
+    _p_value = erfc( z / std::sqrt( 2.0 ) );
+  }
+  if ( _p_value < alpha )
+  {
+    _verdict = _u > mean ? SLOWER : FASTER;
+  }
+
+  // bootstrap confidence intervals of the quantile shifts
+  std::vector< double > qs;
+  qs.push_back( 0.5 );
+  qs.push_back( 0.99 );
+  std::vector< double > bq, cq;
+  detail::bootstrap_quantiles( b, qs, resamples, BASELINE_SEED, bq );
+  detail::bootstrap_quantiles( c, qs, resamples, CANDIDATE_SEED, cq );
+
+  for ( size_t k = 0; k < qs.size(); ++k )
+  {
+    double estimate = 1.0 * c[ detail::quantile_index( qs[ k ], c.size() ) ]
+      - 1.0 * b[ detail::quantile_index( qs[ k ], b.size() ) ];
+    SInterval interval = shift( bq, cq, k, qs.size(), estimate, alpha );
+    if ( k == 0 )
+    {
+      _median = interval;
+    }
+    else
+    {
+      _p99 = interval;
+    }
+  }
+}
+
+timer::SeriesComparison::verdict_t
+timer::SeriesComparison::verdict() const
+{
+  return _verdict;
+}
+
+double
+timer::SeriesComparison::u() const
+{
+  return _u;
+}
+
+double
+timer::SeriesComparison::p_value() const
+{
+  return _p_value;
+}
+
+timer::SeriesComparison::SInterval
+timer::SeriesComparison::median( Stopwatch::timeunit_t timeunit ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  return scale( _median, timeunit );
+}
+
+timer::SeriesComparison::SInterval
+timer::SeriesComparison::p99( Stopwatch::timeunit_t timeunit ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  return scale( _p99, timeunit );
+}
+
+void
+timer::SeriesComparison::print( const char* msg, Stopwatch::timeunit_t timeunit, std::ostream& os ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+
+  os << msg << "Comparison ";
+  switch ( timeunit )
+  {
+    case Stopwatch::MICROSEC:
+      os << "(microsec)";
+      break;
+    case Stopwatch::MILLISEC:
+      os << "(millisec)";
+      break;
+    case Stopwatch::SECONDS:
+      os << "(sec)";
+      break;
+    case Stopwatch::MINUTES:
+      os << "(min)";
+      break;
+    case Stopwatch::HOURS:
+      os << "(h)";
+      break;
+    case Stopwatch::DAYS:
+      os << "(days)";
+      break;
+    default:
+      return;
+  }
+  os << ": baseline n = " << _baseline_size << ", candidate n = " << _candidate_size << std::endl;
+
+  double confidence = 100.0 * ( 1.0 - _alpha );
+  SInterval m = median( timeunit );
+  SInterval p = p99( timeunit );
+  os << "   Mann-Whitney U = " << _u << ", p = " << _p_value << std::endl;
+  os << "     median shift = " << m.estimate << " [" << m.low << ", " << m.high << "] ("
+     << confidence << "% CI)" << std::endl;
+  os << "        p99 shift = " << p.estimate << " [" << p.low << ", " << p.high << "] ("
+     << confidence << "% CI)" << std::endl;
+  os << "          verdict = ";
+  switch ( _verdict )
+  {
+    case FASTER:
+      os << "faster";
+      break;
+    case SLOWER:
+      os << "slower";
+      break;
+    case NOT_SIGNIFICANT:
+      os << "not significant";
+      break;
+  }
+  os << " (alpha = " << _alpha << ")" << std::endl;
+}
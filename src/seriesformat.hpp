@@ -0,0 +1,107 @@
+/**
+ * seriesformat.hpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * Internal layout of the files written by SeriesTimer::save(); not
+ * installed.
+ *
+ * Version 2 (native byte order, 8 byte aligned):
+ *   SSeriesHeader, followed by the payload of the encoding:
+ *     RAW:    'count' uint64 timings
+ *     PACKED: uint64 number of blocks, followed by the block records
+ *             of PackedSamples; blocks may be incomplete, e.g. after
+ *             concatenation.
+ * Version 1:
+ *   magic, version, uint64 count, PACKED payload.
+ */
+
+#ifndef SERIES_FORMAT_H
+#define SERIES_FORMAT_H
+
+#include <cstring>
+#include <stdint.h>
+
+namespace timer
+{
+namespace detail
+{
+
+const char SERIES_MAGIC[ 4 ] = { 'T', 'M', 'S', 'R' };
+const uint32_t SERIES_VERSION_1 = 1;
+const uint32_t SERIES_VERSION = 2;
+
+enum series_clock_t
+{
+  CLOCK_GETTIMEOFDAY = 0 // wall clock of Stopwatch
+};
+
+enum series_encoding_t
+{
+  ENCODING_RAW = 0,
+  ENCODING_PACKED = 1
+};
+
+struct SSeriesHeader
+{
+  char magic[ 4 ];
+  uint32_t version;
+  uint32_t clock;    // series_clock_t
+  uint32_t encoding; // series_encoding_t
+  uint64_t unit;     // timeunit_t of the timings, i.e. microseconds
+  uint64_t count;    // number of timings
+};
+
+/**
+ * Returns a header for 'count' timings in 'encoding'.
+ */
+inline SSeriesHeader
+series_header( series_encoding_t encoding, uint64_t count )
+{
+  SSeriesHeader header;
+  std::memcpy( header.magic, SERIES_MAGIC, sizeof( SERIES_MAGIC ) );
+  header.version = SERIES_VERSION;
+  header.clock = CLOCK_GETTIMEOFDAY;
+  header.encoding = encoding;
+  header.unit = 1; // Stopwatch::MICROSEC
+  header.count = count;
+  return header;
+}
+
+/**
+ * Returns, whether 'header' is a version 2 header, that can be read.
+ */
+inline bool
+valid_header( const SSeriesHeader& header )
+{
+  return std::memcmp( header.magic, SERIES_MAGIC, sizeof( SERIES_MAGIC ) ) == 0
+    && header.version == SERIES_VERSION && header.clock == CLOCK_GETTIMEOFDAY
+    && ( header.encoding == ENCODING_RAW || header.encoding == ENCODING_PACKED )
+    && header.unit == 1;
+}
+
+} /* namespace detail */
+} /* namespace timer */
+#endif /* SERIES_FORMAT_H */
@@ -25,13 +25,37 @@
  */
 
 #include "seriestimer.hpp"
+#include "bootstrap.hpp"
+#include "seriesformat.hpp"
 
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstring>
+#include <fstream>
 
 namespace timer
 {
+namespace
+{
+#ifdef ENABLE_TIMING
+const uint64_t INTERVAL_SEED = 0x5eed0003;
+
+/**
+ * Reorders 'values', such that the 'k' smallest ones are in front of
+ * the 'k' largest ones at the end, with the remaining ones in between.
+ */
+void
+trim( std::vector< Stopwatch::timestamp_t >& values, size_t k )
+{
+  std::vector< size_t > ranks;
+  ranks.push_back( k );
+  ranks.push_back( values.size() - k - 1 );
+  detail::select_ranks( values, ranks );
+}
+#endif
+}
+
 std::ostream&
 operator<<( std::ostream& os, const SeriesTimer& seriestimer )
 {
@@ -40,37 +64,53 @@ operator<<( std::ostream& os, const SeriesTimer& seriestimer )
 }
 }
 
-timer::SeriesTimer::SeriesTimer()
 #ifdef ENABLE_TIMING
-  : _stopwatch()
+timer::SeriesTimer::SeriesTimer( storage_t storage )
+  : _storage( storage )
+  , _stopwatch()
   , _timestamps()
-#endif
+  , _packed()
 {
 }
-
-void
-timer::SeriesTimer::start()
+#else
+timer::SeriesTimer::SeriesTimer( storage_t )
 {
-#ifdef ENABLE_TIMING
-  _stopwatch.start();
-#endif
 }
+#endif
 
 void
-timer::SeriesTimer::stop()
+timer::SeriesTimer::merge( const SeriesTimer& other )
 {
 #ifdef ENABLE_TIMING
-  _stopwatch.stop();
-  _timestamps.push_back( _stopwatch.elapsed_timestamp() );
-  _stopwatch.reset();
-#endif
-}
+  if ( &other == this )
+  {
+    SeriesTimer copy( *this );
+    merge( copy );
+    return;
+  }
 
-bool
-timer::SeriesTimer::isRunning() const
-{
-#ifdef ENABLE_TIMING
-  return _stopwatch.isRunning();
+  if ( _storage == PACKED && other._storage == PACKED )
+  {
+    _packed.append( other._packed );
+    return;
+  }
+
+  std::vector< Stopwatch::timestamp_t > buf;
+  const Stopwatch::timestamp_t* data;
+  if ( _storage == RAW )
+  {
+    _timestamps.reserve( _timestamps.size() + other.size() );
+  }
+  for ( size_t c = 0; c < other.chunks(); ++c )
+  {
+    size_t n = other.chunk( c, buf, data );
+    for ( size_t i = 0; i < n; ++i )
+    {
+      record( data[ i ] );
+    }
+  }
+#else
+  ( void ) other;
 #endif
 }
 
@@ -80,6 +120,17 @@ timer::SeriesTimer::reset()
 #ifdef ENABLE_TIMING
   _stopwatch.reset();
   _timestamps.clear();
+  _packed.clear();
+#endif
+}
+
+size_t
+timer::SeriesTimer::size() const
+{
+#ifdef ENABLE_TIMING
+  return _storage == PACKED ? _packed.size() : _timestamps.size();
+#else
+  return 0;
 #endif
 }
 
@@ -88,11 +139,12 @@ timer::SeriesTimer::timings( Stopwatch::timeunit_t timeunit ) const
 {
 #ifdef ENABLE_TIMING
   assert( Stopwatch::correct_timeunit( timeunit ) );
-  std::vector< double > result( _timestamps.size() );
+  std::vector< Stopwatch::timestamp_t > local = timestamps();
+  std::vector< double > result( local.size() );
   // convert to vector of requestet timeunit
-  for ( size_t i = 0; i < _timestamps.size(); ++i )
+  for ( size_t i = 0; i < local.size(); ++i )
   {
-    result[ i ] = 1.0 * _timestamps[ i ] / timeunit;
+    result[ i ] = 1.0 * local[ i ] / timeunit;
   }
 
   return result;
@@ -102,15 +154,42 @@ timer::SeriesTimer::timings( Stopwatch::timeunit_t timeunit ) const
 #endif
 }
 
+std::vector< timer::Stopwatch::timestamp_t >
+timer::SeriesTimer::timestamps() const
+{
+#ifdef ENABLE_TIMING
+  if ( _storage == RAW )
+  {
+    return _timestamps;
+  }
+  std::vector< Stopwatch::timestamp_t > result( _packed.blocks() * PackedSamples::BLOCK_SIZE );
+  size_t n = 0;
+  for ( size_t b = 0; b < _packed.blocks(); ++b )
+  {
+    n += _packed.decode( b, &result[ n ] );
+  }
+  result.resize( n );
+  return result;
+#else
+  return std::vector< Stopwatch::timestamp_t >();
+#endif
+}
+
 double
 timer::SeriesTimer::sum( Stopwatch::timeunit_t timeunit ) const
 {
 #ifdef ENABLE_TIMING
   assert( Stopwatch::correct_timeunit( timeunit ) );
   double sum = 0.0;
-  for ( size_t i = 0; i < _timestamps.size(); ++i )
+  std::vector< Stopwatch::timestamp_t > buf;
+  const Stopwatch::timestamp_t* data;
+  for ( size_t c = 0; c < chunks(); ++c )
   {
-    sum += _timestamps[ i ];
+    size_t n = chunk( c, buf, data );
+    for ( size_t i = 0; i < n; ++i )
+    {
+      sum += data[ i ];
+    }
   }
   return sum / timeunit;
 #else
@@ -123,9 +202,9 @@ timer::SeriesTimer::mean( Stopwatch::timeunit_t timeunit ) const
 {
 #ifdef ENABLE_TIMING
   assert( Stopwatch::correct_timeunit( timeunit ) );
-  if ( not _timestamps.empty() )
+  if ( size() > 0 )
   {
-    return sum( timeunit ) / _timestamps.size();
+    return sum( timeunit ) / size();
   }
   else
   {
@@ -143,14 +222,20 @@ timer::SeriesTimer::std( Stopwatch::timeunit_t timeunit ) const
   assert( Stopwatch::correct_timeunit( timeunit ) );
   double r = mean( timeunit );
   double sum = 0;
+  std::vector< Stopwatch::timestamp_t > buf;
+  const Stopwatch::timestamp_t* data;
 
-  for ( size_t i = 0; i < _timestamps.size(); ++i )
+  for ( size_t c = 0; c < chunks(); ++c )
   {
-    double tmp = 1.0 * _timestamps[ i ] / timeunit - r; // difference
-    sum += tmp * tmp;                                   // squaring
+    size_t n = chunk( c, buf, data );
+    for ( size_t i = 0; i < n; ++i )
+    {
+      double tmp = 1.0 * data[ i ] / timeunit - r; // difference
+      sum += tmp * tmp;                            // squaring
+    }
   }
   // sqrt of sum of squared differences
-  return std::sqrt( sum / _timestamps.size() );
+  return std::sqrt( sum / size() );
 #else
   return 0.0;
 #endif
@@ -163,22 +248,179 @@ timer::SeriesTimer::quantile( double q, Stopwatch::timeunit_t timeunit ) const
   assert( Stopwatch::correct_timeunit( timeunit ) );
   assert( q >= 0.0 ); // not smaller than min
   assert( q <= 1.0 ); // not larger than max
-  std::vector< Stopwatch::timestamp_t > local = _timestamps;
+  if ( size() == 0 )
+  {
+    return 0.0;
+  }
+  std::vector< Stopwatch::timestamp_t > local = timestamps();
 
-  // quantiles need sorting
-  std::sort( local.begin(), local.end() );
   // select the index of quantile; in doubt select smaller one
-  int32_t i = ( int32_t ) std::ceil( q * local.size() ) - 1;
-  if ( i < 0 ) // if 0 is choosen, the calculation is -1
+  std::vector< Stopwatch::timestamp_t >::iterator i
+    = local.begin() + detail::quantile_index( q, local.size() );
+  std::nth_element( local.begin(), i, local.end() );
+  return 1.0 * *i / timeunit; // return correct timeunit
+#else
+  return 0.0;
+#endif
+}
+
+double
+timer::SeriesTimer::mad( Stopwatch::timeunit_t timeunit ) const
+{
+#ifdef ENABLE_TIMING
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  if ( size() == 0 )
   {
-    i = 0;
+    return 0.0;
   }
-  return 1.0 * local[ i ] / timeunit; // return correct timeunit
+  std::vector< Stopwatch::timestamp_t > local = timestamps();
+  std::vector< Stopwatch::timestamp_t >::iterator mid
+    = local.begin() + detail::quantile_index( 0.5, local.size() );
+  std::nth_element( local.begin(), mid, local.end() );
+  Stopwatch::timestamp_t median = *mid;
+
+  // absolute deviations in place, then their median
+  for ( size_t i = 0; i < local.size(); ++i )
+  {
+    local[ i ] = local[ i ] > median ? local[ i ] - median : median - local[ i ];
+  }
+  std::nth_element( local.begin(), mid, local.end() );
+  return 1.0 * *mid / timeunit;
 #else
   return 0.0;
 #endif
 }
 
+double
+timer::SeriesTimer::trimmed_mean( double fraction, Stopwatch::timeunit_t timeunit ) const
+{
+#ifdef ENABLE_TIMING
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  assert( fraction >= 0.0 && fraction < 0.5 );
+  if ( size() == 0 )
+  {
+    return 0.0;
+  }
+  std::vector< Stopwatch::timestamp_t > local = timestamps();
+  size_t k = ( size_t )( fraction * local.size() );
+  trim( local, k );
+
+  double sum = 0.0;
+  for ( size_t i = k; i < local.size() - k; ++i )
+  {
+    sum += local[ i ];
+  }
+  return sum / ( local.size() - 2 * k ) / timeunit;
+#else
+  return 0.0;
+#endif
+}
+
+double
+timer::SeriesTimer::winsorized_mean( double fraction, Stopwatch::timeunit_t timeunit ) const
+{
+#ifdef ENABLE_TIMING
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  assert( fraction >= 0.0 && fraction < 0.5 );
+  if ( size() == 0 )
+  {
+    return 0.0;
+  }
+  std::vector< Stopwatch::timestamp_t > local = timestamps();
+  size_t k = ( size_t )( fraction * local.size() );
+  trim( local, k );
+
+  // the k smallest (largest) count as the smallest (largest) remaining one
+  double sum = 1.0 * k * local[ k ] + 1.0 * k * local[ local.size() - k - 1 ];
+  for ( size_t i = k; i < local.size() - k; ++i )
+  {
+    sum += local[ i ];
+  }
+  return sum / local.size() / timeunit;
+#else
+  return 0.0;
+#endif
+}
+
+timer::SeriesTimer::SOutliers
+timer::SeriesTimer::outliers() const
+{
+  SOutliers result = { 0, 0, 0, 0 };
+#ifdef ENABLE_TIMING
+  if ( size() == 0 )
+  {
+    return result;
+  }
+  std::vector< Stopwatch::timestamp_t > local = timestamps();
+  std::vector< size_t > ranks;
+  ranks.push_back( detail::quantile_index( 0.25, local.size() ) );
+  ranks.push_back( detail::quantile_index( 0.75, local.size() ) );
+  detail::select_ranks( local, ranks );
+
+  double q1 = local[ ranks[ 0 ] ];
+  double q3 = local[ ranks[ 1 ] ];
+  double iqr = q3 - q1;
+  for ( size_t i = 0; i < local.size(); ++i )
+  {
+    double t = local[ i ];
+    if ( t < q1 - 3.0 * iqr )
+    {
+      ++result.low_severe;
+    }
+    else if ( t < q1 - 1.5 * iqr )
+    {
+      ++result.low_mild;
+    }
+    else if ( t > q3 + 3.0 * iqr )
+    {
+      ++result.high_severe;
+    }
+    else if ( t > q3 + 1.5 * iqr )
+    {
+      ++result.high_mild;
+    }
+  }
+#endif
+  return result;
+}
+
+timer::SeriesTimer::SInterval
+timer::SeriesTimer::confidence_interval( double q,
+  double level,
+  size_t resamples,
+  Stopwatch::timeunit_t timeunit ) const
+{
+  SInterval result = { 0.0, 0.0, 0.0 };
+#ifdef ENABLE_TIMING
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  assert( q >= 0.0 && q <= 1.0 );
+  assert( level > 0.0 && level < 1.0 );
+  if ( size() == 0 || resamples == 0 )
+  {
+    return result;
+  }
+  std::vector< Stopwatch::timestamp_t > local = timestamps();
+  std::vector< double > qs( 1, q );
+  std::vector< size_t > ranks;
+  detail::bootstrap_ranks( local.size(), qs, resamples, INTERVAL_SEED, ranks );
+  size_t estimate = detail::quantile_index( q, local.size() );
+  ranks.push_back( estimate );
+
+  // only the drawn ranks are needed, not the whole order
+  detail::select_ranks( local, ranks );
+  std::vector< double > quantiles( resamples );
+  for ( size_t r = 0; r < resamples; ++r )
+  {
+    quantiles[ r ] = 1.0 * local[ ranks[ r ] ];
+  }
+  double alpha = 1.0 - level;
+  result.estimate = 1.0 * local[ estimate ] / timeunit;
+  result.low = detail::percentile( quantiles, alpha / 2 ) / timeunit;
+  result.high = detail::percentile( quantiles, 1.0 - alpha / 2 ) / timeunit;
+#endif
+  return result;
+}
+
 void
 timer::SeriesTimer::print( const char* msg, Stopwatch::timeunit_t timeunit, std::ostream& os ) const
 {
@@ -229,5 +471,170 @@ timer::SeriesTimer::print( const char* msg, Stopwatch::timeunit_t timeunit, std:
   os << "   q 50% (median) = " << quantile( 0.5, timeunit ) << std::endl;
   os << "            q 75% = " << quantile( 0.75, timeunit ) << std::endl;
   os << "     q 100% (max) = " << quantile( 1.0, timeunit ) << std::endl;
+  if ( size() > 0 )
+  {
+    SInterval ci = confidence_interval( 0.5, 0.95, 1000, timeunit );
+    SOutliers o = outliers();
+    os << "              mad = " << mad( timeunit ) << std::endl;
+    os << "     trimmed mean = " << trimmed_mean( 0.1, timeunit ) << std::endl;
+    os << "  winsorized mean = " << winsorized_mean( 0.1, timeunit ) << std::endl;
+    os << "    median 95% CI = [" << ci.low << ", " << ci.high << "]" << std::endl;
+    os << "         outliers = " << o.low_severe << " low severe, " << o.low_mild
+       << " low mild, " << o.high_mild << " high mild, " << o.high_severe << " high severe"
+       << std::endl;
+  }
 #endif
 }
+
+void
+timer::SeriesTimer::save( std::ostream& os, storage_t encoding ) const
+{
+#ifdef ENABLE_TIMING
+  detail::SSeriesHeader header = detail::series_header(
+    encoding == PACKED ? detail::ENCODING_PACKED : detail::ENCODING_RAW, size() );
+  os.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+  if ( encoding == PACKED && _storage == PACKED )
+  {
+    _packed.write( os );
+  }
+  else if ( encoding == PACKED )
+  {
+    PackedSamples packed;
+    for ( size_t i = 0; i < _timestamps.size(); ++i )
+    {
+      packed.push_back( _timestamps[ i ] );
+    }
+    packed.write( os );
+  }
+  else
+  {
+    std::vector< Stopwatch::timestamp_t > buf;
+    const Stopwatch::timestamp_t* data;
+    for ( size_t c = 0; c < chunks(); ++c )
+    {
+      size_t n = chunk( c, buf, data );
+      os.write( reinterpret_cast< const char* >( data ), n * sizeof( Stopwatch::timestamp_t ) );
+    }
+  }
+#else
+  ( void ) os;
+  ( void ) encoding;
+#endif
+}
+
+bool
+timer::SeriesTimer::save( const std::string& path, storage_t encoding ) const
+{
+  std::ofstream out( path.c_str(), std::ios::binary );
+  save( out, encoding );
+  out.close();
+  return not out.fail();
+}
+
+bool
+timer::SeriesTimer::load( std::istream& is )
+{
+#ifdef ENABLE_TIMING
+  detail::SSeriesHeader header;
+  is.read( reinterpret_cast< char* >( &header ), 2 * sizeof( uint32_t ) );
+  if ( not is
+    || std::memcmp( header.magic, detail::SERIES_MAGIC, sizeof( detail::SERIES_MAGIC ) ) != 0 )
+  {
+    return false;
+  }
+  if ( header.version == detail::SERIES_VERSION_1 )
+  {
+    // magic, version, count and the packed samples
+    header.clock = detail::CLOCK_GETTIMEOFDAY;
+    header.encoding = detail::ENCODING_PACKED;
+    header.unit = 1;
+    is.read( reinterpret_cast< char* >( &header.count ), sizeof( header.count ) );
+    header.version = detail::SERIES_VERSION;
+  }
+  else
+  {
+    is.read( reinterpret_cast< char* >( &header ) + 2 * sizeof( uint32_t ),
+      sizeof( header ) - 2 * sizeof( uint32_t ) );
+  }
+  if ( not is || not detail::valid_header( header ) )
+  {
+    return false;
+  }
+
+  reset();
+  if ( header.encoding == detail::ENCODING_RAW )
+  {
+    std::vector< Stopwatch::timestamp_t > buf( PackedSamples::BLOCK_SIZE );
+    for ( uint64_t i = 0; i < header.count; i += buf.size() )
+    {
+      size_t n = std::min( ( uint64_t ) buf.size(), header.count - i );
+      if ( not is.read( reinterpret_cast< char* >( &buf[ 0 ] ), n * sizeof( buf[ 0 ] ) ) )
+      {
+        reset();
+        return false;
+      }
+      for ( size_t j = 0; j < n; ++j )
+      {
+        record( buf[ j ] );
+      }
+    }
+    return true;
+  }
+
+  if ( not _packed.read( is ) || _packed.size() != header.count )
+  {
+    _packed.clear();
+    return false;
+  }
+  if ( _storage == RAW )
+  {
+    std::vector< Stopwatch::timestamp_t > buf( PackedSamples::BLOCK_SIZE );
+    _timestamps.reserve( header.count );
+    for ( size_t b = 0; b < _packed.blocks(); ++b )
+    {
+      size_t n = _packed.decode( b, &buf[ 0 ] );
+      _timestamps.insert( _timestamps.end(), buf.begin(), buf.begin() + n );
+    }
+    _packed.clear();
+  }
+  return true;
+#else
+  ( void ) is;
+  return false;
+#endif
+}
+
+bool
+timer::SeriesTimer::load( const std::string& path )
+{
+  std::ifstream in( path.c_str(), std::ios::binary );
+  return in && load( in );
+}
+
+#ifdef ENABLE_TIMING
+size_t
+timer::SeriesTimer::chunks() const
+{
+  if ( _storage == PACKED )
+  {
+    return _packed.blocks();
+  }
+  return _timestamps.empty() ? 0 : 1;
+}
+
+size_t
+timer::SeriesTimer::chunk( size_t c,
+  std::vector< Stopwatch::timestamp_t >& buf,
+  const Stopwatch::timestamp_t*& data ) const
+{
+  if ( _storage == PACKED )
+  {
+    buf.resize( PackedSamples::BLOCK_SIZE );
+    data = &buf[ 0 ];
+    return _packed.decode( c, &buf[ 0 ] );
+  }
+  // raw timings are a single chunk
+  data = &_timestamps[ 0 ];
+  return _timestamps.size();
+}
+#endif
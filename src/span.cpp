@@ -0,0 +1,125 @@
+/**
+ * span.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "span.hpp"
+
+#include <cassert>
+
+#if defined( ENABLE_TIMING ) && defined( ENABLE_SCOPETIMER )
+timer::Span::Span( const std::string& name )
+  : _name( name )
+  , _begin( Stopwatch::get_timestamp() )
+  , _last( _begin )
+  , _active( 0 )
+  , _end( 0 )
+  , _suspensions( 0 )
+  , _suspended( false )
+{
+}
+
+timer::Span::~Span()
+{
+  finish();
+}
+
+void
+timer::Span::finish()
+{
+  if ( _end != 0 )
+  {
+    return;
+  }
+  resume();
+  _end = Stopwatch::get_timestamp();
+  _active += _end - _last;
+  _last = _end;
+  detail::add_span( _name, _end - _begin, _active, _suspensions );
+}
+
+double
+timer::Span::total( Stopwatch::timeunit_t timeunit ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  Stopwatch::timestamp_t end = _end != 0 ? _end : Stopwatch::get_timestamp();
+  return 1.0 * ( end - _begin ) / timeunit;
+}
+
+double
+timer::Span::active( Stopwatch::timeunit_t timeunit ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  Stopwatch::timestamp_t active = _active;
+  if ( not _suspended && _end == 0 )
+  {
+    active += Stopwatch::get_timestamp() - _last;
+  }
+  return 1.0 * active / timeunit;
+}
+
+double
+timer::Span::suspended( Stopwatch::timeunit_t timeunit ) const
+{
+  assert( Stopwatch::correct_timeunit( timeunit ) );
+  Stopwatch::timestamp_t now = _end != 0 ? _end : Stopwatch::get_timestamp();
+  Stopwatch::timestamp_t active = _active;
+  if ( not _suspended )
+  {
+    active += now - _last;
+  }
+  return 1.0 * ( now - _begin - active ) / timeunit;
+}
+#else
+timer::Span::Span( const std::string& )
+{
+}
+
+timer::Span::~Span()
+{
+}
+
+void
+timer::Span::finish()
+{
+}
+
+double
+timer::Span::total( Stopwatch::timeunit_t ) const
+{
+  return 0.0;
+}
+
+double
+timer::Span::active( Stopwatch::timeunit_t ) const
+{
+  return 0.0;
+}
+
+double
+timer::Span::suspended( Stopwatch::timeunit_t ) const
+{
+  return 0.0;
+}
+#endif
@@ -26,97 +26,97 @@
 
 #include "stopwatch.hpp"
 
+#include <algorithm>
 #include <cassert>
-#include <sys/time.h>
+#include <vector>
 
 namespace timer
 {
-std::ostream&
-operator<<( std::ostream& os, const Stopwatch& stopwatch )
+namespace
 {
-  stopwatch.print( "", Stopwatch::SECONDS, os );
-  return os;
-}
-}
-
-timer::Stopwatch::Stopwatch()
+#ifdef ENABLE_TIMING
+double
+calibrate_overhead()
 {
-  reset();
-}
+  const size_t batches = 101;
+  const size_t pairs = 100;
+  std::vector< double > per_pair( batches );
+  volatile Stopwatch::timestamp_t sink = 0;
 
-void
-timer::Stopwatch::start()
-{
-#ifdef ENABLE_TIMING
-  if ( not isRunning() )
+  for ( size_t b = 0; b < batches; ++b )
   {
-    _prev_elapsed += _end - _beg;  // store prev. time, if we resume
-    _end = _beg = get_timestamp(); // invariant: _end >= _beg
-    _running = true;               // we start running
+    Stopwatch::timestamp_t begin = Stopwatch::get_timestamp();
+    for ( size_t i = 0; i < pairs; ++i )
+    {
+      Stopwatch x;
+      x.start();
+      x.stop();
+      sink = sink + x.elapsed_timestamp();
+    }
+    per_pair[ b ] = 1.0 * ( Stopwatch::get_timestamp() - begin ) / pairs;
   }
-#endif
+  // median: robust against preemption during a batch
+  std::nth_element( per_pair.begin(), per_pair.begin() + batches / 2, per_pair.end() );
+  return per_pair[ batches / 2 ];
 }
 
-void
-timer::Stopwatch::stop()
+double
+calibrate_resolution()
 {
-#ifdef ENABLE_TIMING
-  if ( isRunning() )
+  Stopwatch::timestamp_t step = ~( Stopwatch::timestamp_t ) 0;
+  for ( size_t i = 0; i < 10; ++i )
   {
-    _end = get_timestamp(); // invariant: _end >= _beg
-    _running = false;       // we stopped running
+    Stopwatch::timestamp_t begin = Stopwatch::get_timestamp();
+    Stopwatch::timestamp_t now;
+    do
+    {
+      now = Stopwatch::get_timestamp();
+    } while ( now == begin );
+    step = std::min( step, now - begin );
   }
+  return 1.0 * step;
+}
 #endif
 }
 
-bool
-timer::Stopwatch::isRunning() const
+std::ostream&
+operator<<( std::ostream& os, const Stopwatch& stopwatch )
 {
-#ifdef ENABLE_TIMING
-  return _running;
-#else
-  return false;
-#endif
+  stopwatch.print( "", Stopwatch::SECONDS, os );
+  return os;
+}
 }
 
 double
-timer::Stopwatch::elapsed( timeunit_t timeunit ) const
+timer::Stopwatch::overhead()
 {
 #ifdef ENABLE_TIMING
-  assert( correct_timeunit( timeunit ) );
-  return 1.0 * elapsed_timestamp() / timeunit;
+  static const double result = calibrate_overhead();
+  return result;
 #else
   return 0.0;
 #endif
 }
 
-timer::Stopwatch::timestamp_t
-timer::Stopwatch::elapsed_timestamp() const
+double
+timer::Stopwatch::resolution()
 {
 #ifdef ENABLE_TIMING
-  if ( isRunning() )
-  {
-    // get intermediate elapsed time; do not change _end, to be const
-    return get_timestamp() - _beg + _prev_elapsed;
-  }
-  else
-  {
-    // stopped before, get time of current measurment + last measurments
-    return _end - _beg + _prev_elapsed;
-  }
+  static const double result = calibrate_resolution();
+  return result;
 #else
-  return ( timestamp_t ) 0;
+  return 0.0;
 #endif
 }
 
-void
-timer::Stopwatch::reset()
+double
+timer::Stopwatch::elapsed( timeunit_t timeunit ) const
 {
 #ifdef ENABLE_TIMING
-  _beg = 0; // invariant: _end >= _beg
-  _end = 0;
-  _prev_elapsed = 0; // erase all prev. measurments
-  _running = false;  // of course not running.
+  assert( correct_timeunit( timeunit ) );
+  return 1.0 * elapsed_timestamp() / timeunit;
+#else
+  return 0.0;
 #endif
 }
 
@@ -155,12 +155,3 @@ timer::Stopwatch::print( const char* msg, timeunit_t timeunit, std::ostream& os
   os << std::endl;
 #endif
 }
-
-timer::Stopwatch::timestamp_t
-timer::Stopwatch::get_timestamp()
-{
-  struct timeval now;
-  gettimeofday( &now, ( struct timezone* ) 0 );
-  return ( timer::Stopwatch::timestamp_t ) now.tv_usec
-    + ( timer::Stopwatch::timestamp_t ) now.tv_sec * timer::Stopwatch::SECONDS;
-}
@@ -0,0 +1,87 @@
+/**
+ * timer_compare.cpp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Tammo Ippen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * Compares two series written with SeriesTimer::save().
+ *
+ *   timer_compare <baseline> <candidate> [alpha] [resamples]
+ *
+ * Exit status: 0 if the candidate is not significantly slower,
+ * 1 if it is slower, 2 on errors. Suitable for gating CI merges.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "seriescomparison.hpp"
+#include "seriestimer.hpp"
+
+using namespace std;
+using namespace timer;
+
+namespace
+{
+bool
+load( const char* path, SeriesTimer& series )
+{
+  ifstream in( path, ios::binary );
+  if ( not in || not series.load( in ) )
+  {
+    cerr << "timer_compare: cannot read series from '" << path << "'" << endl;
+    return false;
+  }
+  return true;
+}
+}
+
+int
+main( int argc, char const** argv )
+{
+  if ( argc < 3 || argc > 5 )
+  {
+    cerr << "usage: " << argv[ 0 ] << " <baseline> <candidate> [alpha] [resamples]" << endl;
+    return 2;
+  }
+  double alpha = argc > 3 ? atof( argv[ 3 ] ) : 0.05;
+  size_t resamples = argc > 4 ? strtoul( argv[ 4 ], 0, 10 ) : 1000;
+  if ( alpha <= 0.0 || alpha >= 1.0 || resamples == 0 )
+  {
+    cerr << "timer_compare: alpha has to be in (0, 1) and resamples positive" << endl;
+    return 2;
+  }
+
+  SeriesTimer baseline;
+  SeriesTimer candidate;
+  if ( not load( argv[ 1 ], baseline ) || not load( argv[ 2 ], candidate ) )
+  {
+    return 2;
+  }
+
+  SeriesComparison comparison( baseline, candidate, alpha, resamples );
+  comparison.print( "", Stopwatch::MICROSEC );
+  return comparison.verdict() == SeriesComparison::SLOWER ? 1 : 0;
+}